@@ -26,6 +26,7 @@
 
 #include <volk/volk.h>
 #include <volk/volk_prefs.h>
+#include <volk/volk_cpu.h>
 
 #include <ciso646>
 #include <vector>
@@ -34,9 +35,21 @@
 #include <boost/xpressive/xpressive.hpp>
 #include <iostream>
 #include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <limits>
+#include <cmath>
+#include <map>
+#include <iomanip>
+#include <boost/lexical_cast.hpp>
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
 namespace fs = boost::filesystem;
 
 int main(int argc, char *argv[]) {
@@ -51,12 +64,58 @@ int main(int argc, char *argv[]) {
       ("tol,t",
             boost::program_options::value<float>()->default_value( 1e-6 ),
             "Set the default error tolerance for tests")
+      ("max-ulp",
+            boost::program_options::value<double>()->default_value( 0 ),
+            "Pass float outputs within this many units in the last place of the generic impl instead of the tolerance")
+      ("max-rel-err",
+            boost::program_options::value<double>()->default_value( 0 ),
+            "Pass float outputs within this error relative to the generic impl instead of the tolerance")
       ("vlen,v",
             boost::program_options::value<int>()->default_value( 131071 ),
             "Set the default vector length for tests") // default is a mersenne prime
       ("iter,i",
             boost::program_options::value<int>()->default_value( 1987 ),
             "Set the default number of test iterations per kernel")
+      ("warmup,w",
+            boost::program_options::value<int>()->default_value( 16 ),
+            "Set the number of untimed calls before timing each implementation")
+      ("rdtsc",
+            boost::program_options::value<bool>()->default_value( false )
+                                                     ->implicit_value( true ),
+            "Time calls with the cpu time stamp counter instead of the monotonic clock (x86 only)")
+      ("cache,c",
+            boost::program_options::value<std::string>()->default_value( "hot" ),
+            "Where the buffers reside: hot reuses them every call, l2, l3 and dram rotate over buffers exceeding the cache level above")
+      ("data,d",
+            boost::program_options::value<std::string>()->default_value( "uniform" ),
+            "Input data: uniform, gaussian, tone, qpsk, denormal or saturate")
+      ("sweep,s",
+            boost::program_options::value<bool>()->default_value( false )
+                                                     ->implicit_value( true ),
+            "Benchmark each kernel over a geometric range of vector lengths and store the best impl per length bucket")
+      ("sweep-min",
+            boost::program_options::value<int>()->default_value( 16 ),
+            "Set the shortest vector length of a sweep")
+      ("sweep-max",
+            boost::program_options::value<int>()->default_value( 131072 ),
+            "Set the longest vector length of a sweep")
+      ("sweep-factor",
+            boost::program_options::value<int>()->default_value( 2 ),
+            "Set the ratio between consecutive vector lengths of a sweep")
+      ("jobs,J",
+            boost::program_options::value<int>()->default_value( 1 ),
+            "Run the kernels in this many worker processes, each pinned to its own physical core")
+      ("threads",
+            boost::program_options::value<int>()->default_value( 1 ),
+            "Run each impl on this many threads at once, pinned to distinct physical cores, to measure it under full load")
+      ("counters",
+            boost::program_options::value<bool>()->default_value( false )
+                                                     ->implicit_value( true ),
+            "Count cycles, instructions, cache misses and AVX frequency licenses of the timed calls (linux perf events)")
+      ("latency,L",
+            boost::program_options::value<bool>()->default_value( false )
+                                                     ->implicit_value( true ),
+            "Measure the latency of single calls at short vector lengths through the dispatcher, _manual and each impl; no config is written")
       ("tests-regex,R",
             boost::program_options::value<std::string>(),
             "Run tests matching regular expression.")
@@ -74,6 +133,20 @@ int main(int argc, char *argv[]) {
       ("path,p",
             boost::program_options::value<std::string>(),
             "Specify volk_config path.")
+      ("text,T",
+            boost::program_options::value<bool>()->default_value( false )
+                                                     ->implicit_value( true ),
+            "Write the text volk_config format instead of the binary one")
+      ("cpu-model,m",
+            boost::program_options::value<bool>()->default_value( false )
+                                                     ->implicit_value( true ),
+            "Write volk_config_<cpu model> instead of volk_config, to be picked up by every host of this cpu model")
+      ("import-text",
+            boost::program_options::value<std::string>(),
+            "Store a text volk_config as this machine's section of the binary volk_config and exit")
+      ("export-text",
+            boost::program_options::value<std::string>(),
+            "Write this machine's section of the volk_config to a text file and exit")
       ;
 
     // Handle the options that were given
@@ -84,11 +157,20 @@ int main(int argc, char *argv[]) {
     float def_tol;
     lv_32fc_t def_scalar;
     int def_iter;
+    int def_warmup;
+    volk_test_timer_t def_timer;
+    volk_test_cache_t def_cache;
+    volk_test_data_t def_data;
     int def_vlen;
     bool def_benchmark_mode;
     std::string def_kernel_regex;
     bool update_mode = false;
     bool dry_run = false;
+    bool text_config = false;
+    std::vector<unsigned int> sweep_vlens;
+    int n_jobs = 1;
+    int n_threads = 1;
+    bool latency = false;
     std::string config_file;
 
     // Handle the provided options
@@ -107,10 +189,41 @@ int main(int argc, char *argv[]) {
         def_scalar = 327.0;
         def_vlen = vm["vlen"].as<int>();
         def_iter = vm["iter"].as<int>();
+        def_warmup = vm["warmup"].as<int>();
+        def_timer = vm["rdtsc"].as<bool>() ? VOLK_TIMER_RDTSC : VOLK_TIMER_MONOTONIC;
+        try {
+            def_cache = volk_test_cache_from_string(vm["cache"].as<std::string>());
+            def_data = volk_test_data_from_string(vm["data"].as<std::string>());
+        }
+        catch (std::string error) {
+            throw boost::program_options::error(error);
+        }
         def_benchmark_mode = benchmark_mode;
         def_kernel_regex = kernel_regex;
         update_mode = vm["update"].as<bool>();
         dry_run = vm["dry-run"].as<bool>();
+        text_config = vm["text"].as<bool>();
+        n_jobs = vm["jobs"].as<int>();
+        n_threads = vm["threads"].as<int>();
+        latency = vm["latency"].as<bool>();
+        if(n_threads < 1) {
+            throw boost::program_options::error("the number of threads must be at least 1");
+        }
+        if(vm["sweep"].as<bool>()) {
+            const int sweep_max = vm["sweep-max"].as<int>();
+            const int sweep_factor = vm["sweep-factor"].as<int>();
+            if(vm["sweep-min"].as<int>() < 1 || sweep_factor < 2) {
+                throw boost::program_options::error("the sweep needs a minimum of at least 1 and a factor of at least 2");
+            }
+            for(int vlen = vm["sweep-min"].as<int>(); vlen <= sweep_max; vlen *= sweep_factor) {
+                sweep_vlens.push_back(vlen);
+            }
+        }
+        else if(latency) {
+            // typical per packet lengths
+            const unsigned int latency_vlens[] = {1, 8, 64, 512};
+            sweep_vlens.assign(latency_vlens, latency_vlens + 4);
+        }
     }
     catch (boost::program_options::error& error) {
         std::cerr << "Error: " << error.what() << std::endl << std::endl;
@@ -146,15 +259,58 @@ int main(int argc, char *argv[]) {
             return 1;
         }
     }
+    else {
+        char path[1024];
+        volk_get_config_path(path);
+        config_file = std::string(path);
+    }
+
+    if ( vm["cpu-model"].as<bool>() ) {
+        char cpu_model[64];
+        volk_get_cpu_model(cpu_model, sizeof(cpu_model));
+        config_file = (fs::path(config_file).branch_path() /
+                       (std::string("volk_config_") + cpu_model)).string();
+    }
+
+    // Convert between the text and binary config formats
+    if ( vm.count("import-text") ) {
+        std::vector<volk_test_results_t> results;
+        read_results(&results, vm["import-text"].as<std::string>());
+        write_binary_results(&results, config_file);
+        return 0;
+    }
+    if ( vm.count("export-text") ) {
+        std::vector<volk_test_results_t> results;
+        read_results(&results, config_file);
+        write_results(&results, false, vm["export-text"].as<std::string>());
+        return 0;
+    }
 
     volk_test_params_t test_params(def_tol, def_scalar, def_vlen, def_iter,
-        def_benchmark_mode, def_kernel_regex);
+        def_benchmark_mode, def_kernel_regex, def_warmup, def_timer, def_cache, n_threads,
+        vm["counters"].as<bool>(), def_data);
+    test_params = test_params.make_accuracy(vm["max-ulp"].as<double>(), vm["max-rel-err"].as<double>());
+
+    if(n_threads > 1 && n_threads > (int)physical_cores().size()) {
+        std::cerr << "Warning: " << n_threads << " threads share " << physical_cores().size()
+                  << " physical cores" << std::endl;
+    }
+    if(n_threads > 1 && n_jobs > 1) {
+        std::cerr << "Warning: --threads measures under full load, running the kernels one by one" << std::endl;
+        n_jobs = 1;
+    }
+
+    if(def_cache != VOLK_CACHE_HOT) {
+        std::cout << "Cache sizes: L1 " << volk_cache_size(1) << ", L2 " << volk_cache_size(2)
+                  << ", L3 " << volk_cache_size(3) << " bytes" << std::endl;
+    }
 
     // Run tests
     std::vector<volk_test_results_t> results;
+    // the sweep keeps every vector length for the json output
+    std::vector<volk_test_results_t> json_results;
     if(update_mode) {
-        if( vm.count("path") ) read_results(&results, config_file);
-        else read_results(&results);
+        read_results(&results, config_file);
     }
 
 
@@ -170,7 +326,8 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    // Iteratate through list of tests running each one
+    // Pick the tests to run
+    std::vector<size_t> selected_tests;
     for(unsigned int ii = 0; ii < test_cases.size(); ++ii) {
         bool regex_match = true;
 
@@ -197,88 +354,396 @@ int main(int argc, char *argv[]) {
         }
 
         if( regex_match && update ) {
-            try {
-            run_volk_tests(test_case.desc(), test_case.kernel_ptr(), test_case.name(),
-                test_case.test_parameters(), &results, test_case.puppet_master_name());
-            }
-            catch (std::string error) {
-                std::cerr << "Caught Exception in 'run_volk_tests': " << error << std::endl;
-            }
-
+            selected_tests.push_back(ii);
         }
     }
 
+    if(n_jobs > 1 && selected_tests.size() > 1) {
+        run_parallel_tests(test_cases, selected_tests, sweep_vlens, latency, n_jobs, &results, &json_results);
+    }
+    else {
+        for(size_t ii = 0; ii < selected_tests.size(); ++ii) {
+            run_test_case(test_cases[selected_tests[ii]], sweep_vlens, latency, &results, &json_results);
+        }
+    }
 
     // Output results according to provided options
     if(vm.count("json")) {
-        write_json(json_file, results);
+        write_json(json_file, sweep_vlens.empty()? results : json_results);
         json_file.close();
     }
 
-    if(!dry_run) {
-        if(vm.count("path")) write_results(&results, false, config_file);
-        else write_results(&results, false);
+    if(latency) {
+        std::cout << "Latency results are not written to the config" << std::endl;
+    }
+    else if(!dry_run) {
+        if(text_config) write_results(&results, false, config_file);
+        else write_binary_results(&results, config_file);
     }
     else {
         std::cout << "Warning: this was a dry-run. Config not generated" << std::endl;
     }
 }
 
-void read_results(std::vector<volk_test_results_t> *results)
+void run_test_case(volk_test_case_t test_case, const std::vector<unsigned int> &sweep_vlens,
+                   bool latency, std::vector<volk_test_results_t> *results,
+                   std::vector<volk_test_results_t> *json_results)
 {
-    char path[1024];
-    volk_get_config_path(path);
+    if(latency) {
+        try {
+            for(size_t jj = 0; jj < sweep_vlens.size(); ++jj) {
+                volk_test_case_t vlen_case(test_case.desc(), test_case.kernel_ptr(), test_case.name(),
+                    test_case.puppet_master_name(), test_case.test_parameters().make_vlen(sweep_vlens[jj]),
+                    test_case.dispatcher(), test_case.get_impl());
+                run_volk_latency(vlen_case, json_results);
+            }
+        }
+        catch (std::string error) {
+            std::cerr << "Caught Exception in 'run_volk_latency': " << error << std::endl;
+        }
+    }
+    else if(!sweep_vlens.empty()) {
+        std::vector<volk_test_results_t> kernel_sweep;
+        try {
+            for(size_t jj = 0; jj < sweep_vlens.size(); ++jj) {
+                run_volk_tests(test_case.desc(), test_case.kernel_ptr(), test_case.name(),
+                    test_case.test_parameters().make_vlen(sweep_vlens[jj]), &kernel_sweep,
+                    test_case.puppet_master_name(), test_case.get_impl());
+            }
+        }
+        catch (std::string error) {
+            std::cerr << "Caught Exception in 'run_volk_tests': " << error << std::endl;
+        }
+        if(!kernel_sweep.empty()) {
+            results->push_back(sweep_results(test_case.desc(), kernel_sweep));
+            json_results->insert(json_results->end(), kernel_sweep.begin(), kernel_sweep.end());
+        }
+    }
+    else {
+        try {
+        run_volk_tests(test_case.desc(), test_case.kernel_ptr(), test_case.name(),
+            test_case.test_parameters(), results, test_case.puppet_master_name(),
+            test_case.get_impl());
+        }
+        catch (std::string error) {
+            std::cerr << "Caught Exception in 'run_volk_tests': " << error << std::endl;
+        }
+    }
+}
 
-    read_results(results, std::string(path));
+// results travel from the workers as whitespace separated fields
+static std::string dump_string(const std::string &str)
+{
+    return str.empty()? "-" : str;
 }
 
-void read_results(std::vector<volk_test_results_t> *results, std::string path)
+static std::string undump_string(const std::string &str)
 {
-    const fs::path config_path(path);
+    return str == "-"? "" : str;
+}
 
-    if(fs::exists(config_path)) {
-        // a config exists and we are reading results from it
-        std::ifstream config(config_path.string().c_str());
-        char config_line[256];
-        while(config.getline(config_line, 255)) {
-            // tokenize the input line by kernel_name unaligned aligned
-            // then push back in the results vector with fields filled in
-
-            std::vector<std::string> single_kernel_result;
-            std::string config_str(config_line);
-            std::size_t str_size = config_str.size();
-            std::size_t found = 1;
-
-            found = config_str.find(" ");
-            // Split line by spaces
-            while(found && found < str_size) {
-                found = config_str.find(" ");
-                // kernel names MUST be less than 128 chars, which is
-                // a length restricted by volk/volk_prefs.c
-                // on the last token in the parsed string we won't find a space
-                // so make sure we copy at most 128 chars.
-                if(found > 127) {
-                    found = 127;
-                }
-                str_size = config_str.size();
-                char buffer[128];
-                config_str.copy(buffer, found + 1, 0);
-                buffer[found] = '\0';
-                single_kernel_result.push_back(std::string(buffer));
-                config_str.erase(0, found+1);
+void write_results_dump(std::ostream &out, size_t test, const std::vector<volk_test_results_t> &results)
+{
+    out << std::setprecision(17);
+    for(size_t ii = 0; ii < results.size(); ++ii) {
+        const volk_test_results_t &result = results[ii];
+        out << test << " " << dump_string(result.name) << " " << dump_string(result.config_name)
+            << " " << result.vlen << " " << result.iter << " " << result.bytes_per_point
+            << " " << dump_string(result.cache_mode) << " " << dump_string(result.data) << " " << result.working_set << " " << result.threads
+            << " " << dump_string(result.best_arch_a) << " " << dump_string(result.best_arch_u)
+            << " " << result.bucket_arch_a.size();
+        for(size_t bucket = 0; bucket < result.bucket_arch_a.size(); ++bucket) {
+            out << " " << dump_string(result.bucket_arch_a[bucket])
+                << " " << dump_string(result.bucket_arch_u[bucket]);
+        }
+        out << " " << result.results.size() << std::endl;
+
+        std::map<std::string, volk_test_time_t>::const_iterator time;
+        for(time = result.results.begin(); time != result.results.end(); ++time) {
+            const volk_test_time_t &t = time->second;
+            out << dump_string(t.name) << " " << t.time << " " << dump_string(t.units) << " " << t.pass
+                << " " << t.samples << " " << t.min << " " << t.median << " " << t.p99
+                << " " << t.mean << " " << t.ci_low << " " << t.ci_high
+                << " " << dump_string(t.stat_units) << " " << t.counters.size();
+            std::map<std::string, double>::const_iterator count;
+            for(count = t.counters.begin(); count != t.counters.end(); ++count) {
+                out << " " << count->first << " " << count->second;
+            }
+            out << " " << dump_string(t.error_reference)
+                << " " << t.max_ulp << " " << t.mean_ulp << " " << t.max_rel_err << " " << t.mean_rel_err
+                << " " << t.nonfinite_mismatches << " " << t.domain_max_ulp << " " << t.domain_mean_ulp
+                << " " << t.domain_max_rel_err << " " << t.domain_nonfinite_mismatches;
+            out << " " << t.histogram_start << " " << t.histogram_width << " " << t.histogram.size();
+            for(size_t bin = 0; bin < t.histogram.size(); ++bin) out << " " << t.histogram[bin];
+            out << std::endl;
+        }
+    }
+}
+
+void read_results_dump(std::istream &in, std::map<size_t, std::vector<volk_test_results_t> > *results)
+{
+    size_t test, n_buckets, n_times;
+    while(in >> test) {
+        volk_test_results_t result;
+        std::string name, config_name, cache_mode, data, best_arch_a, best_arch_u;
+        in >> name >> config_name >> result.vlen >> result.iter >> result.bytes_per_point
+           >> cache_mode >> data >> result.working_set >> result.threads >> best_arch_a >> best_arch_u >> n_buckets;
+        result.name = undump_string(name);
+        result.config_name = undump_string(config_name);
+        result.cache_mode = undump_string(cache_mode);
+        result.data = undump_string(data);
+        result.best_arch_a = undump_string(best_arch_a);
+        result.best_arch_u = undump_string(best_arch_u);
+        for(size_t bucket = 0; bucket < n_buckets; ++bucket) {
+            std::string arch_a, arch_u;
+            in >> arch_a >> arch_u;
+            result.bucket_arch_a.push_back(undump_string(arch_a));
+            result.bucket_arch_u.push_back(undump_string(arch_u));
+        }
+
+        in >> n_times;
+        for(size_t ii = 0; ii < n_times && in; ++ii) {
+            volk_test_time_t t;
+            std::string units, stat_units;
+            in >> t.name >> t.time >> units >> t.pass >> t.samples >> t.min >> t.median
+               >> t.p99 >> t.mean >> t.ci_low >> t.ci_high >> stat_units;
+            t.units = undump_string(units);
+            t.stat_units = undump_string(stat_units);
+            size_t n_counters = 0;
+            in >> n_counters;
+            for(size_t jj = 0; jj < n_counters && in; ++jj) {
+                std::string counter;
+                in >> counter;
+                in >> t.counters[counter];
+            }
+            size_t n_bins = 0;
+            std::string error_reference;
+            in >> error_reference;
+            t.error_reference = undump_string(error_reference);
+            in >> t.max_ulp >> t.mean_ulp >> t.max_rel_err >> t.mean_rel_err >> t.nonfinite_mismatches
+               >> t.domain_max_ulp >> t.domain_mean_ulp >> t.domain_max_rel_err >> t.domain_nonfinite_mismatches;
+            in >> t.histogram_start >> t.histogram_width >> n_bins;
+            t.histogram.resize(n_bins);
+            for(size_t bin = 0; bin < n_bins && in; ++bin) in >> t.histogram[bin];
+            result.results[t.name] = t;
+        }
+        if(in) (*results)[test].push_back(result);
+    }
+}
+
+// shard the selected tests over worker processes pinned to distinct
+// physical cores and merge their results in the order of the test list
+void run_parallel_tests(std::vector<volk_test_case_t> &test_cases,
+                        const std::vector<size_t> &selected_tests,
+                        const std::vector<unsigned int> &sweep_vlens, bool latency, int n_jobs,
+                        std::vector<volk_test_results_t> *results,
+                        std::vector<volk_test_results_t> *json_results)
+{
+#if defined(__linux__)
+    std::vector<int> cores = physical_cores();
+    if((int)cores.size() < n_jobs) {
+        std::cerr << "Warning: only " << cores.size() << " physical cores are available, running "
+                  << cores.size() << " jobs" << std::endl;
+        n_jobs = cores.size();
+    }
+
+    // busy cores disturb the timings of the workers pinned to them,
+    // volk_profile itself is one of the running processes; other processes
+    // are not kept off those cores, so this only warns
+    double load = 0;
+    std::ifstream loadavg("/proc/loadavg");
+    loadavg >> load;
+    const long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if(load - 1 > n_cpus - n_jobs) {
+        std::cerr << "Warning: the load average of " << load << " leaves fewer idle cpus than the "
+                  << n_jobs << " jobs need, results may be disturbed" << std::endl;
+    }
+
+    if(n_jobs > 1) {
+        std::vector<pid_t> workers;
+        std::vector<std::string> dumps;
+        for(int job = 0; job < n_jobs; ++job) {
+            dumps.push_back((fs::temp_directory_path() / fs::unique_path("volk_profile_%%%%%%%%")).string());
+            std::cout.flush();
+            const pid_t pid = fork();
+            if(pid < 0) {
+                std::cerr << "Error: could not start worker " << job << std::endl;
+                continue;
+            }
+            if(pid > 0) {
+                std::cout << "Worker " << job << " runs on cpu " << cores[job] << std::endl;
+                workers.push_back(pid);
+                continue;
             }
 
-            if(single_kernel_result.size() == 3) {
-                volk_test_results_t kernel_result;
-                kernel_result.name = std::string(single_kernel_result[0]);
-                kernel_result.config_name = std::string(single_kernel_result[0]);
-                kernel_result.best_arch_u = std::string(single_kernel_result[1]);
-                kernel_result.best_arch_a = std::string(single_kernel_result[2]);
-                results->push_back(kernel_result);
+            // the worker
+            cpu_set_t cpu;
+            CPU_ZERO(&cpu);
+            CPU_SET(cores[job], &cpu);
+            if(sched_setaffinity(0, sizeof(cpu), &cpu) != 0) {
+                std::cerr << "Warning: worker " << job << " could not be pinned to cpu " << cores[job] << std::endl;
             }
+            std::ofstream dump(dumps[job].c_str());
+            for(size_t ii = job; ii < selected_tests.size(); ii += n_jobs) {
+                std::vector<volk_test_results_t> test_results, test_json_results;
+                run_test_case(test_cases[selected_tests[ii]], sweep_vlens, latency, &test_results, &test_json_results);
+                write_results_dump(dump, 2*ii, test_results);
+                write_results_dump(dump, 2*ii + 1, test_json_results);
+            }
+            dump.close();
+            // skip the exit handlers of the parent, like saving tuned kernels,
+            // but not the output of the kernels
+            std::cout.flush();
+            std::cerr.flush();
+            fflush(stdout);
+            fflush(stderr);
+            _exit(dump.fail()? 1 : 0);
+        }
+
+        std::map<size_t, std::vector<volk_test_results_t> > dumped;
+        for(size_t job = 0; job < workers.size(); ++job) {
+            int status;
+            waitpid(workers[job], &status, 0);
+            if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                std::cerr << "Error: worker " << job << " failed, its kernels are missing" << std::endl;
+            }
+        }
+        for(size_t job = 0; job < dumps.size(); ++job) {
+            std::ifstream dump(dumps[job].c_str());
+            read_results_dump(dump, &dumped);
+            dump.close();
+            fs::remove(dumps[job]);
+        }
+
+        std::map<size_t, std::vector<volk_test_results_t> >::iterator test;
+        for(test = dumped.begin(); test != dumped.end(); ++test) {
+            std::vector<volk_test_results_t> *merged = (test->first % 2)? json_results : results;
+            merged->insert(merged->end(), test->second.begin(), test->second.end());
+        }
+        return;
+    }
+#else
+    std::cerr << "Warning: parallel jobs need linux, running the tests one by one" << std::endl;
+#endif
+    for(size_t ii = 0; ii < selected_tests.size(); ++ii) {
+        run_test_case(test_cases[selected_tests[ii]], sweep_vlens, latency, results, json_results);
+    }
+}
+
+bool has_buckets(const volk_test_results_t &result)
+{
+    if(result.bucket_arch_a.size() != VOLK_N_VLEN_BUCKETS ||
+       result.bucket_arch_u.size() != VOLK_N_VLEN_BUCKETS) return false;
+    for(size_t bucket = 0; bucket < VOLK_N_VLEN_BUCKETS; ++bucket) {
+        if(result.bucket_arch_a[bucket] != result.best_arch_a ||
+           result.bucket_arch_u[bucket] != result.best_arch_u) return true;
+    }
+    return false;
+}
+
+// the impl with the lowest mean slowdown against the fastest impl over the
+// swept vector lengths of a bucket, or "" when no length falls into it
+static std::string sweep_best_arch(volk_func_desc_t desc, const std::vector<volk_test_results_t> &sweep,
+                                   size_t bucket, bool aligned)
+{
+    std::map<std::string, double> slowdown;
+    std::map<std::string, bool> usable;
+    for(size_t ii = 0; ii < desc.n_impls; ++ii) {
+        usable[desc.impl_names[ii]] = aligned || !desc.impl_alignment[ii];
+    }
+
+    size_t n_points = 0;
+    for(size_t ii = 0; ii < sweep.size(); ++ii) {
+        if(volk_vlen_bucket(sweep[ii].vlen) != bucket) continue;
+        double fastest = std::numeric_limits<double>::max();
+        std::map<std::string, volk_test_time_t>::const_iterator time;
+        for(time = sweep[ii].results.begin(); time != sweep[ii].results.end(); ++time) {
+            // an impl that failed at any length of the bucket is not used
+            if(!time->second.pass) usable[time->first] = false;
+            if(usable[time->first] && time->second.median < fastest) fastest = time->second.median;
+        }
+        for(time = sweep[ii].results.begin(); time != sweep[ii].results.end(); ++time) {
+            slowdown[time->first] += (fastest > 0)? time->second.median / fastest : 1.0;
         }
+        n_points++;
+    }
+    if(n_points == 0) return "";
+
+    std::string best_arch;
+    double best_slowdown = std::numeric_limits<double>::max();
+    std::map<std::string, double>::const_iterator arch;
+    for(arch = slowdown.begin(); arch != slowdown.end(); ++arch) {
+        if(usable[arch->first] && arch->second < best_slowdown) {
+            best_slowdown = arch->second;
+            best_arch = arch->first;
+        }
+    }
+    return best_arch.empty()? "generic" : best_arch;
+}
+
+volk_test_results_t sweep_results(volk_func_desc_t desc, const std::vector<volk_test_results_t> &sweep)
+{
+    volk_test_results_t result = sweep.back();
+    result.results.clear();
+    result.bucket_arch_a.resize(VOLK_N_VLEN_BUCKETS);
+    result.bucket_arch_u.resize(VOLK_N_VLEN_BUCKETS);
+    for(size_t bucket = 0; bucket < VOLK_N_VLEN_BUCKETS; ++bucket) {
+        result.bucket_arch_a[bucket] = sweep_best_arch(desc, sweep, bucket, true);
+        result.bucket_arch_u[bucket] = sweep_best_arch(desc, sweep, bucket, false);
     }
 
+    // buckets the sweep did not reach use the closest swept one
+    for(size_t bucket = 1; bucket < VOLK_N_VLEN_BUCKETS; ++bucket) {
+        if(result.bucket_arch_a[bucket].empty()) {
+            result.bucket_arch_a[bucket] = result.bucket_arch_a[bucket-1];
+            result.bucket_arch_u[bucket] = result.bucket_arch_u[bucket-1];
+        }
+    }
+    for(size_t bucket = VOLK_N_VLEN_BUCKETS-1; bucket > 0; --bucket) {
+        if(result.bucket_arch_a[bucket-1].empty()) {
+            result.bucket_arch_a[bucket-1] = result.bucket_arch_a[bucket];
+            result.bucket_arch_u[bucket-1] = result.bucket_arch_u[bucket];
+        }
+    }
+
+    // the large bucket is the impl of the plain config entry
+    result.best_arch_a = result.bucket_arch_a[VOLK_VLEN_BUCKET_LARGE];
+    result.best_arch_u = result.bucket_arch_u[VOLK_VLEN_BUCKET_LARGE];
+    std::cout << "Best impls for " << result.config_name << " by vector length:";
+    for(size_t bucket = 0; bucket < VOLK_N_VLEN_BUCKETS; ++bucket) {
+        std::cout << " " << result.bucket_arch_a[bucket] << "/" << result.bucket_arch_u[bucket];
+    }
+    std::cout << std::endl;
+    return result;
+}
+
+void read_results(std::vector<volk_test_results_t> *results)
+{
+    char path[1024];
+    volk_get_config_path(path);
+
+    read_results(results, std::string(path));
+}
+
+void read_results(std::vector<volk_test_results_t> *results, std::string path)
+{
+    // the library reads both the binary and the text config formats
+    volk_arch_pref_t *prefs = NULL;
+    const size_t n_prefs = volk_load_preferences_file(path.c_str(), &prefs);
+
+    for(size_t ii = 0; ii < n_prefs; ++ii) {
+        volk_test_results_t kernel_result;
+        kernel_result.name = std::string(prefs[ii].name);
+        kernel_result.config_name = std::string(prefs[ii].name);
+        kernel_result.best_arch_a = std::string(prefs[ii].impl_a);
+        kernel_result.best_arch_u = std::string(prefs[ii].impl_u);
+        for(size_t bucket = 0; bucket < VOLK_N_VLEN_BUCKETS; ++bucket) {
+            kernel_result.bucket_arch_a.push_back(std::string(prefs[ii].bucket_impl_a[bucket]));
+            kernel_result.bucket_arch_u.push_back(std::string(prefs[ii].bucket_impl_u[bucket]));
+        }
+        results->push_back(kernel_result);
+    }
+    volk_free_preferences(prefs);
 }
 
 void write_results(const std::vector<volk_test_results_t> *results, bool update_result)
@@ -319,6 +784,7 @@ void write_results(const std::vector<volk_test_results_t> *results, bool update_
         config << "\
 #this file is generated by volk_profile.\n\
 #the function name is followed by the preferred architecture.\n\
+#swept kernels add the small and medium vector length buckets.\n\
 ";
     }
 
@@ -326,11 +792,70 @@ void write_results(const std::vector<volk_test_results_t> *results, bool update_
     for(profile_results = results->begin(); profile_results != results->end(); ++profile_results) {
         config << profile_results->config_name << " "
             << profile_results->best_arch_a << " "
-            << profile_results->best_arch_u << std::endl;
+            << profile_results->best_arch_u;
+        if(has_buckets(*profile_results)) {
+            config << " " << profile_results->bucket_arch_a[VOLK_VLEN_BUCKET_SMALL]
+                << " " << profile_results->bucket_arch_u[VOLK_VLEN_BUCKET_SMALL]
+                << " " << profile_results->bucket_arch_a[VOLK_VLEN_BUCKET_MEDIUM]
+                << " " << profile_results->bucket_arch_u[VOLK_VLEN_BUCKET_MEDIUM];
+        }
+        config << std::endl;
     }
     config.close();
 }
 
+void write_binary_results(const std::vector<volk_test_results_t> *results, const std::string path)
+{
+    const fs::path config_path(path);
+
+    if (not fs::exists(config_path.branch_path()))
+    {
+        std::cout << "Creating " << config_path.branch_path() << "..." << std::endl;
+        fs::create_directories(config_path.branch_path());
+    }
+
+    // without a sweep every vector length bucket uses the best impl of the run
+    std::vector<volk_arch_pref_t> prefs(results->size());
+    for(size_t ii = 0; ii < results->size(); ++ii) {
+        volk_arch_pref_t &pref = prefs[ii];
+        memset(&pref, 0, sizeof(pref));
+        (*results)[ii].config_name.copy(pref.name, sizeof(pref.name) - 1);
+        (*results)[ii].best_arch_a.copy(pref.impl_a, sizeof(pref.impl_a) - 1);
+        (*results)[ii].best_arch_u.copy(pref.impl_u, sizeof(pref.impl_u) - 1);
+        for(size_t bucket = 0; bucket < VOLK_N_VLEN_BUCKETS; ++bucket) {
+            if(has_buckets((*results)[ii])) {
+                (*results)[ii].bucket_arch_a[bucket].copy(pref.bucket_impl_a[bucket], sizeof(pref.impl_a) - 1);
+                (*results)[ii].bucket_arch_u[bucket].copy(pref.bucket_impl_u[bucket], sizeof(pref.impl_u) - 1);
+            }
+            else {
+                memcpy(pref.bucket_impl_a[bucket], pref.impl_a, sizeof(pref.impl_a));
+                memcpy(pref.bucket_impl_u[bucket], pref.impl_u, sizeof(pref.impl_u));
+            }
+        }
+    }
+
+    char cpu_model[64];
+    volk_get_cpu_model(cpu_model, sizeof(cpu_model));
+    std::cout << "Writing " << config_path << " for " << volk_get_machine()
+        << " on " << cpu_model << "..." << std::endl;
+    if(volk_write_binary_preferences(config_path.string().c_str(), volk_get_machine(),
+        cpu_model, prefs.empty()? NULL : &prefs[0], prefs.size()) != 0) {
+        std::cout << "Error writing file " << config_path << std::endl;
+    }
+}
+
+// JSON has no nan or inf, write null for them
+struct json_number {
+    double value;
+    json_number(double value) : value(value) {}
+};
+
+static std::ostream &operator<<(std::ostream &out, const json_number &number)
+{
+    if(!std::isfinite(number.value)) return out << "null";
+    return out << number.value;
+}
+
 void write_json(std::ofstream &json_file, std::vector<volk_test_results_t> results)
 {
     json_file << "{" << std::endl;
@@ -343,6 +868,10 @@ void write_json(std::ofstream &json_file, std::vector<volk_test_results_t> resul
         json_file << "   \"name\": \"" << result->name << "\"," << std::endl;
         json_file << "   \"vlen\": " << (int)(result->vlen) << "," << std::endl;
         json_file << "   \"iter\": " << result->iter << "," << std::endl;
+        json_file << "   \"cache\": \"" << result->cache_mode << "\"," << std::endl;
+        json_file << "   \"data\": \"" << result->data << "\"," << std::endl;
+        json_file << "   \"working_set_bytes\": " << result->working_set << "," << std::endl;
+        json_file << "   \"threads\": " << result->threads << "," << std::endl;
         json_file << "   \"best_arch_a\": \"" << result->best_arch_a
             << "\"," << std::endl;
         json_file << "   \"best_arch_u\": \"" << result->best_arch_u
@@ -356,8 +885,71 @@ void write_json(std::ofstream &json_file, std::vector<volk_test_results_t> resul
             volk_test_time_t time = kernel_time_pair->second;
             json_file << "    \"" << time.name << "\": {" << std::endl;
             json_file << "     \"name\": \"" << time.name << "\"," << std::endl;
-            json_file << "     \"time\": " << time.time << "," << std::endl;
-            json_file << "     \"units\": \"" << time.units << "\"" << std::endl;
+            json_file << "     \"time\": " << json_number(time.time) << "," << std::endl;
+            json_file << "     \"units\": \"" << time.units << "\"," << std::endl;
+            json_file << "     \"pass\": " << (time.pass ? "true" : "false") << "," << std::endl;
+            json_file << "     \"samples\": " << time.samples << "," << std::endl;
+            json_file << "     \"min\": " << json_number(time.min) << "," << std::endl;
+            json_file << "     \"median\": " << json_number(time.median) << "," << std::endl;
+            json_file << "     \"p99\": " << json_number(time.p99) << "," << std::endl;
+            json_file << "     \"mean\": " << json_number(time.mean) << "," << std::endl;
+            json_file << "     \"median_ci\": [" << json_number(time.ci_low) << ", " << json_number(time.ci_high) << "]," << std::endl;
+            json_file << "     \"stat_units\": \"" << time.stat_units << "\"";
+            // throughput of the median call, when it was timed in ns
+            if(time.stat_units == "ns" && time.median > 0) {
+                const double samples_per_sec = result->vlen * 1e9 / time.median;
+                json_file << "," << std::endl;
+                json_file << "     \"samples_per_sec\": " << json_number(samples_per_sec) << "," << std::endl;
+                json_file << "     \"bytes_per_sec\": " << json_number(samples_per_sec * result->bytes_per_point);
+            }
+            if(time.max_ulp >= 0) {
+                json_file << "," << std::endl;
+                json_file << "     \"error_reference\": \"" << time.error_reference << "\"," << std::endl;
+                json_file << "     \"max_ulp\": " << json_number(time.max_ulp) << "," << std::endl;
+                json_file << "     \"mean_ulp\": " << json_number(time.mean_ulp) << "," << std::endl;
+                json_file << "     \"max_rel_err\": " << json_number(time.max_rel_err) << "," << std::endl;
+                json_file << "     \"mean_rel_err\": " << json_number(time.mean_rel_err) << "," << std::endl;
+                json_file << "     \"nonfinite_mismatches\": " << time.nonfinite_mismatches;
+            }
+            if(time.domain_max_ulp >= 0) {
+                json_file << "," << std::endl;
+                json_file << "     \"domain_max_ulp\": " << json_number(time.domain_max_ulp) << "," << std::endl;
+                json_file << "     \"domain_mean_ulp\": " << json_number(time.domain_mean_ulp) << "," << std::endl;
+                json_file << "     \"domain_max_rel_err\": " << json_number(time.domain_max_rel_err) << "," << std::endl;
+                json_file << "     \"domain_nonfinite_mismatches\": " << time.domain_nonfinite_mismatches;
+            }
+            if(!time.thread_throughput.empty()) {
+                double aggregate = 0;
+                json_file << "," << std::endl;
+                json_file << "     \"thread_samples_per_sec\": [";
+                for(size_t thread = 0; thread < time.thread_throughput.size(); ++thread) {
+                    json_file << (thread ? ", " : "") << json_number(time.thread_throughput[thread]);
+                    aggregate += time.thread_throughput[thread];
+                }
+                json_file << "]," << std::endl;
+                json_file << "     \"aggregate_samples_per_sec\": " << json_number(aggregate);
+            }
+            if(!time.histogram.empty()) {
+                json_file << "," << std::endl;
+                json_file << "     \"histogram_start\": " << json_number(time.histogram_start) << "," << std::endl;
+                json_file << "     \"histogram_width\": " << json_number(time.histogram_width) << "," << std::endl;
+                json_file << "     \"histogram\": [";
+                for(size_t bin = 0; bin < time.histogram.size(); ++bin) {
+                    json_file << (bin ? ", " : "") << time.histogram[bin];
+                }
+                json_file << "]";
+            }
+            if(!time.counters.empty()) {
+                json_file << "," << std::endl;
+                json_file << "     \"counters\": {";
+                std::map<std::string, double>::const_iterator count;
+                for(count = time.counters.begin(); count != time.counters.end(); ++count) {
+                    json_file << (count == time.counters.begin() ? "" : ", ")
+                              << "\"" << count->first << "\": " << json_number(count->second);
+                }
+                json_file << "}";
+            }
+            json_file << std::endl;
             json_file << "    }" ;
             if(ri+1 != results_len) {
                 json_file << ",";
@@ -1,7 +1,20 @@
 
 
+void run_test_case(volk_test_case_t test_case, const std::vector<unsigned int> &sweep_vlens,
+                   bool latency, std::vector<volk_test_results_t> *results,
+                   std::vector<volk_test_results_t> *json_results);
+void write_results_dump(std::ostream &out, size_t test, const std::vector<volk_test_results_t> &results);
+void read_results_dump(std::istream &in, std::map<size_t, std::vector<volk_test_results_t> > *results);
+void run_parallel_tests(std::vector<volk_test_case_t> &test_cases,
+                        const std::vector<size_t> &selected_tests,
+                        const std::vector<unsigned int> &sweep_vlens, bool latency, int n_jobs,
+                        std::vector<volk_test_results_t> *results,
+                        std::vector<volk_test_results_t> *json_results);
+bool has_buckets(const volk_test_results_t &result);
+volk_test_results_t sweep_results(volk_func_desc_t desc, const std::vector<volk_test_results_t> &sweep);
 void read_results(std::vector<volk_test_results_t> *results);
 void read_results(std::vector<volk_test_results_t> *results, std::string path);
 void write_results(const std::vector<volk_test_results_t> *results, bool update_result);
 void write_results(const std::vector<volk_test_results_t> *results, bool update_result, const std::string path);
+void write_binary_results(const std::vector<volk_test_results_t> *results, const std::string path);
 void write_json(std::ofstream &json_file, std::vector<volk_test_results_t> results);
@@ -0,0 +1,203 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2016 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace po = boost::program_options;
+namespace pt = boost::property_tree;
+
+// the cost of the fastest passing impl of a kernel in one run
+struct kernel_cost {
+    std::string arch;
+    double cost;        // per sample, in units
+    std::string units;  // ns or ticks
+};
+
+typedef std::map<std::string, kernel_cost> run_costs;
+
+// per sample cost of one impl: the median call when volk_profile recorded
+// it, the total time of all iterations otherwise
+static bool impl_cost(const pt::ptree &impl, unsigned int vlen, unsigned int iter,
+                      const std::string &metric, double *cost, std::string *units)
+{
+    if(!impl.get<bool>("pass", true) || vlen == 0) return false;
+
+    const std::string stat_units = impl.get<std::string>("stat_units", "");
+    if(metric != "time" && !stat_units.empty()) {
+        // volk_profile writes null for values it could not measure
+        const boost::optional<double> value = impl.get_optional<double>(metric);
+        if(!value) return false;
+        *cost = *value / vlen;
+        *units = stat_units;
+        return true;
+    }
+    if(iter == 0) return false;
+    const std::string time_units = impl.get<std::string>("units", "ms");
+    const boost::optional<double> time = impl.get_optional<double>("time");
+    if(!time) return false;
+    *cost = *time / iter / vlen;
+    if(time_units == "ms") {
+        *cost *= 1e6;
+        *units = "ns";
+    }
+    else {
+        *units = time_units;
+    }
+    return true;
+}
+
+// the kernels of a volk_profile --json file, keyed by everything that
+// changes what was measured
+static run_costs read_run(const std::string &path, const std::string &metric)
+{
+    pt::ptree tree;
+    pt::read_json(path, tree);
+
+    run_costs costs;
+    BOOST_FOREACH(const pt::ptree::value_type &test, tree.get_child("volk_tests")) {
+        const pt::ptree &kernel = test.second;
+        const unsigned int vlen = kernel.get<unsigned int>("vlen", 0);
+        const unsigned int iter = kernel.get<unsigned int>("iter", 0);
+        std::string key = kernel.get<std::string>("name") + " vlen " +
+            boost::lexical_cast<std::string>(vlen);
+        if(kernel.get<std::string>("cache", "hot") != "hot") {
+            key += " cache " + kernel.get<std::string>("cache");
+        }
+        if(kernel.get<std::string>("data", "uniform") != "uniform") {
+            key += " data " + kernel.get<std::string>("data");
+        }
+        if(kernel.get<unsigned int>("threads", 1) != 1) {
+            key += " threads " + kernel.get<std::string>("threads");
+        }
+
+        kernel_cost best;
+        best.cost = std::numeric_limits<double>::max();
+        BOOST_FOREACH(const pt::ptree::value_type &impl, kernel.get_child("results")) {
+            double cost;
+            std::string units;
+            if(impl_cost(impl.second, vlen, iter, metric, &cost, &units) && cost < best.cost) {
+                best.arch = impl.first;
+                best.cost = cost;
+                best.units = units;
+            }
+        }
+        if(!best.arch.empty()) costs[key] = best;
+    }
+    return costs;
+}
+
+int main(int argc, char *argv[])
+{
+    po::options_description desc("Program options: volk_profile_compare [options] baseline.json other.json...");
+    desc.add_options()
+        ("help,h", "Print help messages")
+        ("threshold,t", po::value<double>()->default_value(5.0),
+            "Flag kernels whose best impl is this many percent slower than in the baseline")
+        ("metric,m", po::value<std::string>()->default_value("median"),
+            "Per call statistic to compare: median, min, mean, p99, or time for the total of all iterations")
+        ("all,a", "List every kernel, not only the regressed ones")
+        ("files", po::value<std::vector<std::string> >(), "volk_profile --json files, the first one is the baseline")
+        ;
+    po::positional_options_description positional;
+    positional.add("files", -1);
+
+    po::variables_map vm;
+    try {
+        po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+        po::notify(vm);
+    }
+    catch (po::error &error) {
+        std::cerr << "Error: " << error.what() << std::endl << std::endl;
+        std::cerr << desc << std::endl;
+        return 2;
+    }
+
+    if(vm.count("help") || !vm.count("files") || vm["files"].as<std::vector<std::string> >().size() < 2) {
+        std::cout << "Compares volk_profile --json results against a baseline." << std::endl
+                  << "Exits with 1 when a kernel regressed." << std::endl
+                  << desc << std::endl;
+        return vm.count("help") ? 0 : 2;
+    }
+
+    const std::vector<std::string> files = vm["files"].as<std::vector<std::string> >();
+    const std::string metric = vm["metric"].as<std::string>();
+    const double threshold = vm["threshold"].as<double>() / 100.0;
+    if(metric != "median" && metric != "min" && metric != "mean" && metric != "p99" && metric != "time") {
+        std::cerr << "Error: unknown metric " << metric << std::endl;
+        return 2;
+    }
+
+    std::vector<run_costs> runs;
+    try {
+        for(size_t ii = 0; ii < files.size(); ++ii) {
+            runs.push_back(read_run(files[ii], metric));
+        }
+    }
+    catch (pt::ptree_error &error) {
+        std::cerr << "Error: " << error.what() << std::endl;
+        return 2;
+    }
+
+    size_t n_regressions = 0;
+    std::cout << std::fixed << std::setprecision(4);
+    for(size_t ii = 1; ii < runs.size(); ++ii) {
+        std::cout << "Comparing " << files[ii] << " to " << files[0] << std::endl;
+        run_costs::const_iterator base;
+        for(base = runs[0].begin(); base != runs[0].end(); ++base) {
+            run_costs::const_iterator other = runs[ii].find(base->first);
+            if(other == runs[ii].end()) {
+                if(vm.count("all")) std::cout << "  missing     " << base->first << std::endl;
+                continue;
+            }
+            if(other->second.units != base->second.units) {
+                std::cout << "  skipped     " << base->first << ": timed in " << base->second.units
+                          << " and " << other->second.units << std::endl;
+                continue;
+            }
+
+            const double ratio = other->second.cost / base->second.cost;
+            const bool regressed = ratio > 1.0 + threshold;
+            if(regressed) n_regressions++;
+            if(!regressed && !vm.count("all")) continue;
+
+            const char *verdict = regressed ? "REGRESSION" : (ratio < 1.0 - threshold ? "faster" : "same");
+            std::cout << "  " << std::left << std::setw(12) << verdict << base->first << ": "
+                      << base->second.arch << " " << base->second.cost << " -> "
+                      << other->second.arch << " " << other->second.cost << " "
+                      << base->second.units << "/sample (" << std::showpos
+                      << 100.0 * (ratio - 1.0) << std::noshowpos << "%)" << std::endl;
+        }
+    }
+
+    std::cout << n_regressions << " regression(s) over " << 100.0 * threshold << "%" << std::endl;
+    return n_regressions ? 1 : 0;
+}
@@ -185,6 +185,11 @@ class kernel_class:
         self.arglist_types = ', '.join([a[0] for a in self.args])
         self.arglist_full = ', '.join(['%s %s'%a for a in self.args])
         self.arglist_names = ', '.join([a[1] for a in self.args])
+        #kernels with a num_points argument can dispatch by vector length
+        self.has_num_points = 'num_points' in [a[1] for a in self.args]
+        #the dispatcher may split calls of elementwise kernels at any point
+        self.is_elementwise = (self.name in elementwise_kernels and
+            self.has_num_points and not self.has_dispatcher)
 
     def get_impls(self, archs):
         archs = set(archs)
@@ -197,6 +202,92 @@ class kernel_class:
     def __repr__(self):
         return self.name
 
+########################################################################
+# Kernels whose point i of every output only depends on point i of the
+# inputs, and whose buffers hold one element of their pointer type per
+# point. Kernels with state, reductions and lookups are left out.
+########################################################################
+elementwise_kernels = set([
+    'volk_16i_convert_8i',
+    'volk_16i_s32f_convert_32f',
+    'volk_16ic_convert_32fc',
+    'volk_16ic_deinterleave_16i_x2',
+    'volk_16ic_deinterleave_real_16i',
+    'volk_16ic_deinterleave_real_8i',
+    'volk_16ic_magnitude_16i',
+    'volk_16ic_s32f_deinterleave_32f_x2',
+    'volk_16ic_s32f_deinterleave_real_32f',
+    'volk_16ic_s32f_magnitude_32f',
+    'volk_16ic_x2_multiply_16ic',
+    'volk_16u_byteswap',
+    'volk_32f_acos_32f',
+    'volk_32f_asin_32f',
+    'volk_32f_atan_32f',
+    'volk_32f_binary_slicer_32i',
+    'volk_32f_binary_slicer_8i',
+    'volk_32f_convert_64f',
+    'volk_32f_cos_32f',
+    'volk_32f_expfast_32f',
+    'volk_32f_invsqrt_32f',
+    'volk_32f_log2_32f',
+    'volk_32f_s32f_convert_16i',
+    'volk_32f_s32f_convert_32i',
+    'volk_32f_s32f_convert_8i',
+    'volk_32f_s32f_multiply_32f',
+    'volk_32f_s32f_normalize',
+    'volk_32f_s32f_power_32f',
+    'volk_32f_sin_32f',
+    'volk_32f_sqrt_32f',
+    'volk_32f_tan_32f',
+    'volk_32f_tanh_32f',
+    'volk_32f_x2_add_32f',
+    'volk_32f_x2_divide_32f',
+    'volk_32f_x2_interleave_32fc',
+    'volk_32f_x2_max_32f',
+    'volk_32f_x2_min_32f',
+    'volk_32f_x2_multiply_32f',
+    'volk_32f_x2_pow_32f',
+    'volk_32f_x2_s32f_interleave_16ic',
+    'volk_32f_x2_subtract_32f',
+    'volk_32fc_32f_multiply_32fc',
+    'volk_32fc_conjugate_32fc',
+    'volk_32fc_convert_16ic',
+    'volk_32fc_deinterleave_32f_x2',
+    'volk_32fc_deinterleave_64f_x2',
+    'volk_32fc_deinterleave_imag_32f',
+    'volk_32fc_deinterleave_real_32f',
+    'volk_32fc_deinterleave_real_64f',
+    'volk_32fc_magnitude_32f',
+    'volk_32fc_magnitude_squared_32f',
+    'volk_32fc_s32f_atan2_32f',
+    'volk_32fc_s32f_deinterleave_real_16i',
+    'volk_32fc_s32f_magnitude_16i',
+    'volk_32fc_s32f_power_32fc',
+    'volk_32fc_s32f_power_spectrum_32f',
+    'volk_32fc_s32f_x2_power_spectral_density_32f',
+    'volk_32fc_s32fc_multiply_32fc',
+    'volk_32fc_x2_divide_32fc',
+    'volk_32fc_x2_multiply_32fc',
+    'volk_32fc_x2_multiply_conjugate_32fc',
+    'volk_32i_s32f_convert_32f',
+    'volk_32i_x2_and_32i',
+    'volk_32i_x2_or_32i',
+    'volk_32u_byteswap',
+    'volk_64f_convert_32f',
+    'volk_64f_x2_max_64f',
+    'volk_64f_x2_min_64f',
+    'volk_64u_byteswap',
+    'volk_8i_convert_16i',
+    'volk_8i_s32f_convert_32f',
+    'volk_8ic_deinterleave_16i_x2',
+    'volk_8ic_deinterleave_real_16i',
+    'volk_8ic_deinterleave_real_8i',
+    'volk_8ic_s32f_deinterleave_32f_x2',
+    'volk_8ic_s32f_deinterleave_real_32f',
+    'volk_8ic_x2_multiply_conjugate_16ic',
+    'volk_8ic_x2_s32f_multiply_conjugate_32fc',
+])
+
 ########################################################################
 # Extract information from the VOLK kernels
 ########################################################################
@@ -205,5 +296,19 @@ srcdir = os.path.dirname(os.path.dirname(__file__))
 kernel_files = glob.glob(os.path.join(srcdir, "kernels", "volk", "*.h"))
 kernels = map(kernel_class, kernel_files)
 
+#keep the kernels in name order and number them, so the generated code
+#can look a kernel up by binary search and index tables by kernel
+kernels.sort(key=lambda kern: kern.name)
+for index, kern in enumerate(kernels):
+    kern.index = index
+
+#a renamed or removed kernel must not silently lose its peeling
+unknown_elementwise = elementwise_kernels.difference([kern.name for kern in kernels])
+if unknown_elementwise:
+    raise Exception, 'elementwise_kernels lists kernels that do not exist: %s'%(', '.join(sorted(unknown_elementwise)))
+unpeeled = [kern.name for kern in kernels if kern.name in elementwise_kernels and not kern.is_elementwise]
+if unpeeled:
+    raise Exception, 'elementwise_kernels lists kernels without num_points or with a dispatcher: %s'%(', '.join(unpeeled))
+
 if __name__ == '__main__':
     print kernels
@@ -0,0 +1,95 @@
+#
+# Copyright 2016 Free Software Foundation, Inc.
+#
+# This file is part of GNU Radio
+#
+# GNU Radio is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3, or (at your option)
+# any later version.
+#
+# GNU Radio is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with GNU Radio; see the file COPYING.  If not, write to
+# the Free Software Foundation, Inc., 51 Franklin Street,
+# Boston, MA 02110-1301, USA.
+#
+
+import os
+import glob
+from volk_arch_defs import archs
+from volk_kernel_defs import kernels
+
+kernel_dict = dict((kern.name, kern) for kern in kernels)
+
+class profile_pref_class:
+    def __init__(self, kern, fields):
+        self.kern = kern
+        self.impl_a, self.impl_u = fields[0:2]
+        #without bucket entries the impl is used for all vector lengths
+        if len(fields) == 6: self.bucket_impls = fields[2:6]
+        else: self.bucket_impls = fields[0:2] * 2
+
+    def __repr__(self): return self.kern.name
+
+class profile_class:
+    def __init__(self, cpu_model, prefs):
+        self.cpu_model = cpu_model
+        self.cname = cpu_model.replace('-', '_')
+        self.prefs = prefs
+
+    def __repr__(self): return self.cpu_model
+
+def parse_profile(path):
+    prefs = dict()
+    for line in open(path):
+        fields = line.split()
+        if len(fields) not in (3, 7): continue
+        #skip comments and kernels this tree does not have
+        if fields[0] not in kernel_dict: continue
+        #the first entry for a kernel wins, like in the library
+        if fields[0] in prefs: continue
+        prefs[fields[0]] = profile_pref_class(kernel_dict[fields[0]], fields[1:])
+    return sorted(prefs.values(), key=lambda p: p.kern.index)
+
+########################################################################
+# Pick the aligned and unaligned impl of a kernel for static dispatch:
+# the preferred impls when the machine has them, otherwise the impl with
+# the largest deps mask, like volk_rank_archs does at runtime.
+# Orc and asm impls are compiled into libvolk and cannot be inlined.
+########################################################################
+def static_impls(kern, arch_names, pref=None):
+    impls = [i for i in kern.get_impls(arch_names)
+             if 'orc' not in i.deps and not i.name.endswith('asm')]
+    names = [i.name for i in impls]
+    def deps_mask(impl):
+        return sum(1 << archs.index(a) for a in archs if a.name in impl.deps)
+    def best(candidates):
+        return max(candidates, key=deps_mask).name
+    impl_a = best(impls)
+    impl_u = best([i for i in impls if not i.is_aligned])
+    if pref is not None and pref.impl_a in names: impl_a = pref.impl_a
+    if pref is not None and pref.impl_u in names and not impls[names.index(pref.impl_u)].is_aligned:
+        impl_u = pref.impl_u
+    return impl_a, impl_u
+
+########################################################################
+# Load the reference profiles written by volk_profile --text --cpu-model,
+# the part of the file name after volk_config_ is the cpu model it was
+# run on (vendor-family-model, optionally with the stepping)
+########################################################################
+gendir = os.path.dirname(os.path.abspath(__file__))
+profile_files = sorted(glob.glob(os.path.join(gendir, 'profiles', 'volk_config_*')))
+
+profiles = list()
+for profile_file in profile_files:
+    cpu_model = os.path.basename(profile_file)[len('volk_config_'):]
+    profiles.append(profile_class(cpu_model, parse_profile(profile_file)))
+
+if __name__ == '__main__':
+    for profile in profiles:
+        print profile, len(profile.prefs)
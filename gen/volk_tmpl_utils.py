@@ -27,6 +27,7 @@ import optparse
 import volk_arch_defs
 import volk_machine_defs
 import volk_kernel_defs
+import volk_profile_defs
 from Cheetah import Template
 
 def __escape_pre_processor(code):
@@ -51,6 +52,9 @@ def __parse_tmpl(_tmpl, **kwargs):
         'machines': volk_machine_defs.machines,
         'machine_dict': volk_machine_defs.machine_dict,
         'kernels': volk_kernel_defs.kernels,
+        'profiles': volk_profile_defs.profiles,
+        'parse_profile': volk_profile_defs.parse_profile,
+        'static_impls': volk_profile_defs.static_impls,
     }
     defs.update(kwargs)
     _tmpl = __escape_pre_processor(_tmpl)
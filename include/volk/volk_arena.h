@@ -0,0 +1,120 @@
+/* -*- c -*- */
+/*
+ * Copyright 2016 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_VOLK_ARENA_H
+#define INCLUDED_VOLK_ARENA_H
+
+#include <volk/volk_common.h>
+#include <stdlib.h>
+
+__VOLK_DECL_BEGIN
+
+/*!
+ * \brief A block of aligned memory handing out scratch buffers.
+ *
+ * \details
+ * An arena is allocated once with volk_arena_create. volk_arena_alloc
+ * then hands out buffers from it by advancing an offset, and
+ * volk_arena_reset releases all of them at once. Neither calls the
+ * system allocator, so a DSP block can create an arena when it starts
+ * and take its per-call scratch buffers from it. An arena must only be
+ * used by one thread at a time.
+ */
+typedef struct volk_arena volk_arena_t;
+
+/*!
+ * \brief Create an arena of \p size bytes.
+ * \param size The number of bytes the arena can hand out.
+ * \return the arena, or NULL when it could not be allocated.
+ */
+VOLK_API volk_arena_t *volk_arena_create(size_t size);
+
+/*!
+ * \brief Take \p size bytes from an arena.
+ *
+ * \details
+ * The buffer is aligned to volk_get_alignment(). It stays valid until
+ * the next volk_arena_reset and must not be passed to volk_free.
+ *
+ * \param arena The arena to allocate from.
+ * \param size The number of bytes to allocate.
+ * \return pointer to aligned memory, or NULL when the arena is full.
+ */
+VOLK_API void *volk_arena_alloc(volk_arena_t *arena, size_t size);
+
+/*!
+ * \brief Release all buffers of an arena at once.
+ * \param arena The arena to reset.
+ */
+VOLK_API void volk_arena_reset(volk_arena_t *arena);
+
+/*!
+ * \brief The number of bytes handed out since the last reset.
+ * \param arena The arena.
+ * \return the used bytes, including the alignment padding.
+ */
+VOLK_API size_t volk_arena_used(const volk_arena_t *arena);
+
+/*!
+ * \brief Free an arena and all of its buffers.
+ * \param arena The arena created by volk_arena_create.
+ */
+VOLK_API void volk_arena_destroy(volk_arena_t *arena);
+
+/*!
+ * \brief Allocate \p size bytes from the pool of the calling thread.
+ *
+ * \details
+ * Buffers up to VOLK_POOL_MAX_SIZE bytes are rounded up to a power of
+ * two. Freed buffers are kept on a free list of the thread that frees
+ * them and are handed out again by the next volk_pool_alloc of that
+ * size class, so a block allocating the same sizes every call only
+ * reaches the system allocator on its first calls. Larger buffers are
+ * allocated with volk_malloc. The buffers are aligned to
+ * volk_get_alignment().
+ *
+ * \param size The number of bytes to allocate.
+ * \return pointer to aligned memory, or NULL when out of memory.
+ */
+VOLK_API void *volk_pool_alloc(size_t size);
+
+/*!
+ * \brief Return a buffer of volk_pool_alloc to the pool.
+ * \param ptr The buffer, NULL is ignored.
+ */
+VOLK_API void volk_pool_free(void *ptr);
+
+/*!
+ * \brief Free the buffers the pool of the calling thread keeps.
+ *
+ * \details
+ * A thread's kept buffers are freed when it exits. Call this to release
+ * them earlier, for instance after a burst of large allocations.
+ */
+VOLK_API void volk_pool_trim(void);
+
+//! The largest buffer the pool keeps on its free lists
+#define VOLK_POOL_MAX_SIZE (1 << 20)
+
+__VOLK_DECL_END
+
+#endif /* INCLUDED_VOLK_ARENA_H */
@@ -61,6 +61,97 @@ VOLK_API void *volk_malloc(size_t size, size_t alignment);
  */
 VOLK_API void volk_free(void *aptr);
 
+//! volk_malloc_huge flag: ask the kernel to back the buffer with transparent huge pages
+#define VOLK_MALLOC_HUGE_TRANSPARENT 0x1
+//! volk_malloc_huge flag: map reserved huge pages, transparent ones when none are free
+#define VOLK_MALLOC_HUGE_EXPLICIT 0x2
+//! volk_malloc_huge flag: touch every page before returning, placing it now
+#define VOLK_MALLOC_PREFAULT 0x4
+
+/*!
+ * \brief Where the pages of a volk_malloc_huge buffer reside.
+ */
+typedef struct volk_malloc_placement
+{
+    size_t page_size;   //!< size of the pages mapped, the huge page size for explicit huge pages
+    size_t huge_bytes;  //!< bytes of the buffer currently backed by huge pages
+    int numa_node;      //!< node of the first page, -1 when unknown
+} volk_malloc_placement_t;
+
+/*!
+ * \brief Allocate a large buffer of \p size bytes with huge pages and
+ * numa placement.
+ *
+ * \details
+ * Streaming kernels over buffers of many megabytes are limited by TLB
+ * misses and, on multi socket machines, by memory of the remote node.
+ * volk_malloc_huge maps the buffer directly, aligned to the huge page
+ * size when huge pages are requested in \p flags. With \p numa_node
+ * of 0 or more the pages are bound to that node; with -1 they are
+ * placed on the node of the thread that touches them first, which is
+ * the calling thread with VOLK_MALLOC_PREFAULT. One page in front of
+ * the buffer (a huge page with VOLK_MALLOC_HUGE_EXPLICIT) holds its
+ * bookkeeping.
+ *
+ * Where the system has no huge pages or numa support the request is
+ * ignored; volk_malloc_placement reports what was granted. Free the
+ * buffer with volk_free_huge.
+ *
+ * \param size The number of bytes to allocate.
+ * \param flags VOLK_MALLOC_HUGE_TRANSPARENT, VOLK_MALLOC_HUGE_EXPLICIT and VOLK_MALLOC_PREFAULT.
+ * \param numa_node The node to bind the pages to, or -1.
+ * \return pointer to page aligned memory, or NULL when out of memory.
+ */
+VOLK_API void *volk_malloc_huge(size_t size, int flags, int numa_node);
+
+/*!
+ * \brief Report where the pages of a volk_malloc_huge buffer reside.
+ * \param ptr The buffer allocated by volk_malloc_huge.
+ * \param placement Filled with the page size, huge page backing and node.
+ */
+VOLK_API void volk_malloc_placement(void *ptr, volk_malloc_placement_t *placement);
+
+/*!
+ * \brief Free memory allocated by volk_malloc_huge.
+ * \param ptr The buffer, NULL is ignored.
+ */
+VOLK_API void volk_free_huge(void *ptr);
+
+/*!
+ * \brief The smallest size of a ring buffer holding \p size bytes.
+ *
+ * \details
+ * Ring buffers are a power of two of bytes and at least one page.
+ *
+ * \param size The number of bytes the ring must hold.
+ * \return the size to pass to volk_malloc_ring.
+ */
+VOLK_API size_t volk_ring_size(size_t size);
+
+/*!
+ * \brief Allocate a ring buffer of \p size bytes that is mapped twice.
+ *
+ * \details
+ * The \p size bytes from the returned pointer are followed by a second
+ * mapping of the same memory, so byte i and byte i + \p size are the
+ * same. A window of up to \p size bytes starting anywhere in the ring
+ * is contiguous, and kernels can read or write across the end of the
+ * ring without splitting the call or copying. The ring is aligned to at
+ * least volk_get_alignment().
+ *
+ * This needs memfd_create and mmap (Linux); elsewhere NULL is returned.
+ *
+ * \param size The ring size in bytes, as returned by volk_ring_size.
+ * \return pointer to the ring, or NULL when it could not be mapped.
+ */
+VOLK_API void *volk_malloc_ring(size_t size);
+
+/*!
+ * \brief Free a ring buffer allocated by volk_malloc_ring.
+ * \param ptr The ring, NULL is ignored.
+ */
+VOLK_API void volk_free_ring(void *ptr);
+
 __VOLK_DECL_END
 
 #endif /* INCLUDED_VOLK_MALLOC_H */
@@ -3,27 +3,150 @@
 
 #include <volk/volk_common.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 __VOLK_DECL_BEGIN
 
+////////////////////////////////////////////////////////////////////////
+// vector length buckets for size-aware dispatch:
+// calls with num_points < VOLK_VLEN_SMALL_MAX use the small bucket,
+// calls with num_points < VOLK_VLEN_MEDIUM_MAX use the medium bucket,
+// and everything else uses the large bucket (impl_a/impl_u).
+////////////////////////////////////////////////////////////////////////
+#define VOLK_VLEN_SMALL_MAX 64
+#define VOLK_VLEN_MEDIUM_MAX 4096
+
+enum volk_vlen_bucket
+{
+    VOLK_VLEN_BUCKET_SMALL = 0,
+    VOLK_VLEN_BUCKET_MEDIUM,
+    VOLK_VLEN_BUCKET_LARGE,
+    VOLK_N_VLEN_BUCKETS
+};
+
+static inline size_t volk_vlen_bucket(unsigned int num_points)
+{
+    if(num_points < VOLK_VLEN_SMALL_MAX) return VOLK_VLEN_BUCKET_SMALL;
+    if(num_points < VOLK_VLEN_MEDIUM_MAX) return VOLK_VLEN_BUCKET_MEDIUM;
+    return VOLK_VLEN_BUCKET_LARGE;
+}
+
 typedef struct volk_arch_pref
 {
     char name[128];   //name of the kernel
     char impl_a[128]; //best aligned impl
     char impl_u[128]; //best unaligned impl
+    char bucket_impl_a[VOLK_N_VLEN_BUCKETS][128]; //best aligned impl per vector length bucket
+    char bucket_impl_u[VOLK_N_VLEN_BUCKETS][128]; //best unaligned impl per vector length bucket
 } volk_arch_pref_t;
 
 ////////////////////////////////////////////////////////////////////////
-// get path to volk_config profiling info;
+// binary volk_config layout, in native byte order:
+// a header, a table of sections keyed by volk machine name and cpu model,
+// then the volk_arch_pref_t records of every section back to back.
+// The records are used in place, so the file is mapped and not parsed.
+////////////////////////////////////////////////////////////////////////
+#define VOLK_CONFIG_MAGIC "VOLKCFG"
+#define VOLK_CONFIG_VERSION 1
+
+typedef struct volk_config_header
+{
+    char magic[8];        //VOLK_CONFIG_MAGIC
+    uint32_t version;     //VOLK_CONFIG_VERSION
+    uint32_t pref_size;   //sizeof(volk_arch_pref_t) of the writer
+    uint32_t n_sections;  //number of entries in the section table
+    uint32_t reserved;
+} volk_config_header_t;
+
+typedef struct volk_config_section
+{
+    char machine[64];     //volk machine name, see volk_get_machine()
+    char cpu_model[64];   //cpu model, see volk_get_cpu_model(); "" for any
+    uint64_t offset;      //file offset of the first record
+    uint64_t n_prefs;     //number of records
+} volk_config_section_t;
+
+////////////////////////////////////////////////////////////////////////
+// reference profiles built into the library from gen/profiles:
+// the prefs of a profile end with an entry whose name is NULL,
+// a list of profiles ends with an entry whose cpu_model is NULL.
+////////////////////////////////////////////////////////////////////////
+typedef struct volk_default_pref
+{
+    const char *name;            //name of the kernel
+    const char *impl_a;          //best aligned impl
+    const char *impl_u;          //best unaligned impl
+    const char *bucket_impls[4]; //small_a, small_u, medium_a, medium_u
+} volk_default_pref_t;
+
+typedef struct volk_default_profile
+{
+    const char *cpu_model;            //cpu model the profile was measured on
+    const volk_default_pref_t *prefs; //its preferences
+} volk_default_profile_t;
+
+////////////////////////////////////////////////////////////////////////
+// load the profile for cpu_model from a list of reference profiles,
+// preferring the exact cpu model over the same model in another stepping;
+// returns the number of prefs, release them with volk_free_preferences.
+////////////////////////////////////////////////////////////////////////
+VOLK_API size_t volk_load_default_preferences(const volk_default_profile_t *profiles,
+    const char *cpu_model, volk_arch_pref_t **prefs);
+
+////////////////////////////////////////////////////////////////////////
+// check that a kernel provides every impl that pref names, in all
+// vector length buckets; returns 1 when it does and 0 otherwise.
+////////////////////////////////////////////////////////////////////////
+VOLK_API int volk_pref_usable(const volk_arch_pref_t *pref,
+    const char *impl_names[], size_t n_impls);
+
+////////////////////////////////////////////////////////////////////////
+// get path to volk_config profiling info, where volk_profile writes;
+// VOLK_CONFIGPATH may list several directories, the first one is used;
 // returns \0 in the argument on failure.
 ////////////////////////////////////////////////////////////////////////
 VOLK_API void volk_get_config_path(char *);
 
 ////////////////////////////////////////////////////////////////////////
-// load prefs into global prefs struct
+// find the volk_config to load; the directories searched in order are
+// each entry of VOLK_CONFIGPATH (plus "/volk"), $HOME/.volk,
+// $XDG_CONFIG_HOME/volk (or $HOME/.config/volk), /etc/volk and
+// <prefix>/share/volk. Each one is checked for volk_config_<cpu model>,
+// the same without the stepping, then volk_config;
+// returns \0 in the argument when no config exists.
+////////////////////////////////////////////////////////////////////////
+VOLK_API void volk_find_config_path(char *);
+
+////////////////////////////////////////////////////////////////////////
+// load prefs into global prefs struct;
+// the config is either binary (see above) or text, where
+// each config line is "kernel impl_a impl_u", optionally followed by
+// "small_a small_u medium_a medium_u" for the short vector buckets.
 ////////////////////////////////////////////////////////////////////////
 VOLK_API size_t volk_load_preferences(volk_arch_pref_t **);
 
+////////////////////////////////////////////////////////////////////////
+// load prefs for this machine from a binary or text config at path;
+// binary configs use the section that best matches the machine and
+// cpu model and stay mapped for the life of the process.
+////////////////////////////////////////////////////////////////////////
+VOLK_API size_t volk_load_preferences_file(const char *path, volk_arch_pref_t **);
+
+////////////////////////////////////////////////////////////////////////
+// release prefs returned by volk_load_preferences or
+// volk_load_preferences_file, unmapping a binary config; NULL is ignored.
+////////////////////////////////////////////////////////////////////////
+VOLK_API void volk_free_preferences(volk_arch_pref_t *prefs);
+
+////////////////////////////////////////////////////////////////////////
+// store prefs as the section for machine and cpu_model of the binary
+// config at path, keeping the sections of other machines in the file;
+// returns 0 on success and -1 on failure.
+////////////////////////////////////////////////////////////////////////
+VOLK_API int volk_write_binary_preferences(const char *path,
+    const char *machine, const char *cpu_model,
+    const volk_arch_pref_t *prefs, size_t n_prefs);
+
 __VOLK_DECL_END
 
 #endif //INCLUDED_VOLK_PREFS_H
@@ -76,6 +76,43 @@
 #include <inttypes.h>
 #include <stdio.h>
 
+#ifdef LV_HAVE_AVX512F
+#include <immintrin.h>
+
+static inline void
+volk_32f_x2_add_32f_u_avx512f(float* cVector, const float* aVector,
+                              const float* bVector, unsigned int num_points)
+{
+  unsigned int number = 0;
+  const unsigned int sixteenthPoints = num_points / 16;
+
+  float* cPtr = cVector;
+  const float* aPtr = aVector;
+  const float* bPtr=  bVector;
+
+  __m512 aVal, bVal, cVal;
+  for(;number < sixteenthPoints; number++){
+
+    aVal = _mm512_loadu_ps(aPtr);
+    bVal = _mm512_loadu_ps(bPtr);
+
+    cVal = _mm512_add_ps(aVal, bVal);
+
+    _mm512_storeu_ps(cPtr,cVal); // Store the results back into the C container
+
+    aPtr += 16;
+    bPtr += 16;
+    cPtr += 16;
+  }
+
+  number = sixteenthPoints * 16;
+  for(;number < num_points; number++){
+    *cPtr++ = (*aPtr++) + (*bPtr++);
+  }
+}
+#endif /* LV_HAVE_AVX512F */
+
+
 #ifdef LV_HAVE_SSE
 #include <xmmintrin.h>
 
@@ -138,6 +175,43 @@ volk_32f_x2_add_32f_generic(float* cVector, const float* aVector,
 #include <inttypes.h>
 #include <stdio.h>
 
+#ifdef LV_HAVE_AVX512F
+#include <immintrin.h>
+
+static inline void
+volk_32f_x2_add_32f_a_avx512f(float* cVector, const float* aVector,
+                              const float* bVector, unsigned int num_points)
+{
+  unsigned int number = 0;
+  const unsigned int sixteenthPoints = num_points / 16;
+
+  float* cPtr = cVector;
+  const float* aPtr = aVector;
+  const float* bPtr=  bVector;
+
+  __m512 aVal, bVal, cVal;
+  for(;number < sixteenthPoints; number++){
+
+    aVal = _mm512_load_ps(aPtr);
+    bVal = _mm512_load_ps(bPtr);
+
+    cVal = _mm512_add_ps(aVal, bVal);
+
+    _mm512_store_ps(cPtr,cVal); // Store the results back into the C container
+
+    aPtr += 16;
+    bPtr += 16;
+    cPtr += 16;
+  }
+
+  number = sixteenthPoints * 16;
+  for(;number < num_points; number++){
+    *cPtr++ = (*aPtr++) + (*bPtr++);
+  }
+}
+#endif /* LV_HAVE_AVX512F */
+
+
 #ifdef LV_HAVE_SSE
 #include <xmmintrin.h>
 
@@ -9,33 +9,38 @@
 // function names of the pattern kernel_name_*
 
 // for puppets we need to get all the func_variants for the puppet and just
-// keep track of the actual function name to write to results
+// keep track of the actual function name to write to results; the actual
+// function takes other arguments, so there is no pointer to benchmark
 #define VOLK_INIT_PUPP(func, puppet_master_func, test_params)\
     volk_test_case_t(func##_get_func_desc(), (void(*)())func##_manual, std::string(#func),\
-    std::string(#puppet_master_func), test_params)
+    std::string(#puppet_master_func), test_params, NULL, (volk_fn_get_impl)func##_get_impl)
+
+// puppets whose actual function works in place on the puppet's inputs, so
+// the latency benchmark can call the actual function's pointer
+#define VOLK_INIT_PUPP_IN_PLACE(func, puppet_master_func, test_params)\
+    volk_test_case_t(func##_get_func_desc(), (void(*)())func##_manual, std::string(#func),\
+    std::string(#puppet_master_func), test_params, (void(**)())&puppet_master_func, (volk_fn_get_impl)func##_get_impl)
 
 #define VOLK_INIT_TEST(func, test_params)\
     volk_test_case_t(func##_get_func_desc(), (void(*)())func##_manual, std::string(#func),\
-    test_params)
+    test_params, (void(**)())&func, (volk_fn_get_impl)func##_get_impl)
 
 std::vector<volk_test_case_t> init_test_list(volk_test_params_t test_params)
 {
 
     // Some kernels need a lower tolerance
-    volk_test_params_t test_params_inacc = volk_test_params_t(1e-2, test_params.scalar(),
-            test_params.vlen(), test_params.iter(), test_params.benchmark_mode(), test_params.kernel_regex());
-    volk_test_params_t test_params_int1 = volk_test_params_t(1, test_params.scalar(),
-            test_params.vlen(), test_params.iter(), test_params.benchmark_mode(), test_params.kernel_regex());
+    volk_test_params_t test_params_inacc = test_params.make_tol(1e-2);
+    volk_test_params_t test_params_int1 = test_params.make_tol(1);
 
     std::vector<volk_test_case_t> test_cases = boost::assign::list_of
         (VOLK_INIT_PUPP(volk_64u_popcntpuppet_64u, volk_64u_popcnt,     test_params))
 
-        (VOLK_INIT_PUPP(volk_16u_byteswappuppet_16u, volk_16u_byteswap, test_params))
-        (VOLK_INIT_PUPP(volk_32u_byteswappuppet_32u, volk_32u_byteswap, test_params))
+        (VOLK_INIT_PUPP_IN_PLACE(volk_16u_byteswappuppet_16u, volk_16u_byteswap, test_params))
+        (VOLK_INIT_PUPP_IN_PLACE(volk_32u_byteswappuppet_32u, volk_32u_byteswap, test_params))
         (VOLK_INIT_PUPP(volk_32u_popcntpuppet_32u, volk_32u_popcnt_32u,  test_params))
-        (VOLK_INIT_PUPP(volk_64u_byteswappuppet_64u, volk_64u_byteswap, test_params))
+        (VOLK_INIT_PUPP_IN_PLACE(volk_64u_byteswappuppet_64u, volk_64u_byteswap, test_params))
         (VOLK_INIT_PUPP(volk_32fc_s32fc_rotatorpuppet_32fc, volk_32fc_s32fc_x2_rotator_32fc, test_params))
-        (VOLK_INIT_PUPP(volk_8u_conv_k7_r2puppet_8u, volk_8u_x4_conv_k7_r2_8u, volk_test_params_t(0, test_params.scalar(), test_params.vlen(), test_params.iter()/10, test_params.benchmark_mode(), test_params.kernel_regex())))
+        (VOLK_INIT_PUPP(volk_8u_conv_k7_r2puppet_8u, volk_8u_x4_conv_k7_r2_8u, test_params.make_tol(0).make_iter(test_params.iter()/10)))
         (VOLK_INIT_PUPP(volk_32f_x2_fm_detectpuppet_32f, volk_32f_s32f_32f_fm_detect_32f, test_params))
         (VOLK_INIT_TEST(volk_16ic_s32f_deinterleave_real_32f,           test_params))
         (VOLK_INIT_TEST(volk_16ic_deinterleave_real_8i,                 test_params))
@@ -55,9 +60,9 @@ std::vector<volk_test_case_t> init_test_list(volk_test_params_t test_params)
         (VOLK_INIT_TEST(volk_32f_index_max_16u,                         test_params))
         (VOLK_INIT_TEST(volk_32f_index_max_32u,                         test_params))
         (VOLK_INIT_TEST(volk_32fc_32f_multiply_32fc,                    test_params))
-        (VOLK_INIT_TEST(volk_32f_log2_32f,           volk_test_params_t(3, test_params.scalar(), test_params.vlen(), test_params.iter(), test_params.benchmark_mode(), test_params.kernel_regex())))
-        (VOLK_INIT_TEST(volk_32f_expfast_32f,        volk_test_params_t(1e-1, test_params.scalar(), test_params.vlen(), test_params.iter(), test_params.benchmark_mode(), test_params.kernel_regex())))
-        (VOLK_INIT_TEST(volk_32f_x2_pow_32f,         volk_test_params_t(1e-2, test_params.scalar(), test_params.vlen(), test_params.iter(), test_params.benchmark_mode(), test_params.kernel_regex())))
+        (VOLK_INIT_TEST(volk_32f_log2_32f,           test_params.make_tol(3)))
+        (VOLK_INIT_TEST(volk_32f_expfast_32f,        test_params.make_tol(1e-1)))
+        (VOLK_INIT_TEST(volk_32f_x2_pow_32f,         test_params.make_tol(1e-2)))
         (VOLK_INIT_TEST(volk_32f_sin_32f,                               test_params_inacc))
         (VOLK_INIT_TEST(volk_32f_cos_32f,                               test_params_inacc))
         (VOLK_INIT_TEST(volk_32f_tan_32f,                               test_params_inacc))
@@ -76,8 +81,8 @@ std::vector<volk_test_case_t> init_test_list(volk_test_params_t test_params)
         (VOLK_INIT_TEST(volk_32fc_deinterleave_real_64f,                test_params))
         (VOLK_INIT_TEST(volk_32fc_x2_dot_prod_32fc,                     test_params_inacc))
         (VOLK_INIT_TEST(volk_32fc_32f_dot_prod_32fc,                    test_params_inacc))
-        (VOLK_INIT_TEST(volk_32fc_index_max_16u,      volk_test_params_t(3, test_params.scalar(), test_params.vlen(), test_params.iter(), test_params.benchmark_mode(), test_params.kernel_regex())))
-        (VOLK_INIT_TEST(volk_32fc_index_max_32u,      volk_test_params_t(3, test_params.scalar(), test_params.vlen(), test_params.iter(), test_params.benchmark_mode(), test_params.kernel_regex())))
+        (VOLK_INIT_TEST(volk_32fc_index_max_16u,      test_params.make_tol(3)))
+        (VOLK_INIT_TEST(volk_32fc_index_max_32u,      test_params.make_tol(3)))
         (VOLK_INIT_TEST(volk_32fc_s32f_magnitude_16i,                   test_params_int1))
         (VOLK_INIT_TEST(volk_32fc_magnitude_32f,                        test_params_inacc))
         (VOLK_INIT_TEST(volk_32fc_magnitude_squared_32f,                test_params))
@@ -86,16 +91,16 @@ std::vector<volk_test_case_t> init_test_list(volk_test_params_t test_params)
         (VOLK_INIT_TEST(volk_32fc_x2_divide_32fc,                       test_params))
         (VOLK_INIT_TEST(volk_32fc_conjugate_32fc,                       test_params))
         (VOLK_INIT_TEST(volk_32f_s32f_convert_16i,                      test_params))
-        (VOLK_INIT_TEST(volk_32f_s32f_convert_32i,    volk_test_params_t(1, test_params.scalar(), test_params.vlen(), test_params.iter(), test_params.benchmark_mode(), test_params.kernel_regex())))
+        (VOLK_INIT_TEST(volk_32f_s32f_convert_32i,    test_params.make_tol(1)))
         (VOLK_INIT_TEST(volk_32f_convert_64f,                           test_params))
-        (VOLK_INIT_TEST(volk_32f_s32f_convert_8i,     volk_test_params_t(1, test_params.scalar(), test_params.vlen(), test_params.iter(), test_params.benchmark_mode(), test_params.kernel_regex())))
+        (VOLK_INIT_TEST(volk_32f_s32f_convert_8i,     test_params.make_tol(1)))
         (VOLK_INIT_TEST(volk_32fc_convert_16ic,                         test_params))
         (VOLK_INIT_TEST(volk_32fc_s32f_power_spectrum_32f,              test_params))
         (VOLK_INIT_TEST(volk_32fc_x2_square_dist_32f,                   test_params))
         (VOLK_INIT_TEST(volk_32fc_x2_s32f_square_dist_scalar_mult_32f,  test_params))
         (VOLK_INIT_TEST(volk_32f_x2_divide_32f,                         test_params))
         (VOLK_INIT_TEST(volk_32f_x2_dot_prod_32f,                       test_params_inacc))
-        (VOLK_INIT_TEST(volk_32f_x2_s32f_interleave_16ic, volk_test_params_t(1, test_params.scalar(), test_params.vlen(), test_params.iter(), test_params.benchmark_mode(), test_params.kernel_regex())))
+        (VOLK_INIT_TEST(volk_32f_x2_s32f_interleave_16ic, test_params.make_tol(1)))
         (VOLK_INIT_TEST(volk_32f_x2_interleave_32fc,                    test_params))
         (VOLK_INIT_TEST(volk_32f_x2_max_32f,                            test_params))
         (VOLK_INIT_TEST(volk_32f_x2_min_32f,                            test_params))
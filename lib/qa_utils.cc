@@ -15,6 +15,30 @@
 #include <ctime>
 #include <cmath>
 #include <limits>
+#include <algorithm>
+#include <numeric>
+#include <set>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#if defined(__linux__)
+#include <sched.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#define VOLK_QA_HAVE_RDTSC
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#include <x86intrin.h>
+#define VOLK_QA_HAVE_RDTSC
+#endif
 
 #include <volk/volk.h>
 #include <volk/volk_cpu.h>
@@ -32,7 +56,118 @@ void random_floats (t *buf, unsigned n)
     buf[i] = uniform ();
 }
 
-void load_random_data(void *data, volk_type_t type, unsigned int n) {
+// M_PI is missing from the msvc headers
+static const double volk_qa_pi = 3.14159265358979323846;
+
+static double gaussian() {
+    // Box-Muller, rand() + 1 keeps the log finite
+    const double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    const double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * volk_qa_pi * u2);
+}
+
+// one value of a signal like distribution, scaled to about [-1, 1] (the
+// integer range for integer types); complex data alternates I and Q
+static double signal_value(volk_test_data_t dist, volk_type_t type, unsigned int i) {
+    const unsigned int sample = type.is_complex ? i / 2 : i;
+    const bool quadrature = type.is_complex && (i % 2);
+    switch(dist) {
+    case VOLK_DATA_GAUSSIAN:
+        return 0.25 * gaussian();
+    case VOLK_DATA_TONE: {
+        // an off bin tone, the phase stays continuous over the buffer
+        const double phase = 2.0 * volk_qa_pi * 0.0123 * sample + 0.3;
+        return 0.9 * (quadrature ? std::sin(phase) : std::cos(phase));
+    }
+    case VOLK_DATA_QPSK:
+        return (rand() % 2 ? 1.0 : -1.0) / std::sqrt(2.0);
+    case VOLK_DATA_DENORMAL:
+        // below the smallest normal number of the type
+        return uniform() * (type.size == 8 ? std::numeric_limits<double>::min()
+                                           : (double)std::numeric_limits<float>::min());
+    case VOLK_DATA_SATURATE:
+        // the extremes of the range and beyond, for floats past 32 bit ints
+        if(type.is_float) return uniform() * 4.0 * 2147483648.0;
+        switch(rand() % 4) {
+        case 0: return -2.0;
+        case 1: return 2.0;
+        default: return 1.5 * uniform();
+        }
+    default:
+        return uniform();
+    }
+}
+
+template <class t>
+static void store_signal(void *data, unsigned int n, volk_test_data_t dist, volk_type_t type) {
+    const double lowest = (double)std::numeric_limits<t>::min();
+    const double highest = (double)std::numeric_limits<t>::max();
+    for(unsigned int i = 0; i < n; i++) {
+        double value = signal_value(dist, type, i);
+        if(std::numeric_limits<t>::is_integer) {
+            // integers saturate at the limits of their type
+            value = std::floor(value * highest + 0.5);
+            value = std::min(std::max(value, lowest), highest);
+        }
+        ((t *)data)[i] = (t)value;
+    }
+}
+
+static void load_signal_data(void *data, volk_type_t type, unsigned int n, volk_test_data_t dist) {
+    if(type.is_complex) n *= 2;
+    if(type.is_float) {
+        if(type.size == 8) store_signal<double>(data, n, dist, type);
+        else store_signal<float>(data, n, dist, type);
+        return;
+    }
+    switch(type.size) {
+    case 8:
+        if(type.is_signed) store_signal<int64_t>(data, n, dist, type);
+        else store_signal<uint64_t>(data, n, dist, type);
+        break;
+    case 4:
+        if(type.is_signed) store_signal<int32_t>(data, n, dist, type);
+        else store_signal<uint32_t>(data, n, dist, type);
+        break;
+    case 2:
+        if(type.is_signed) store_signal<int16_t>(data, n, dist, type);
+        else store_signal<uint16_t>(data, n, dist, type);
+        break;
+    case 1:
+        if(type.is_signed) store_signal<int8_t>(data, n, dist, type);
+        else store_signal<uint8_t>(data, n, dist, type);
+        break;
+    default:
+        throw "load_random_data: no support for data size > 8 or < 1";
+    }
+}
+
+volk_test_data_t volk_test_data_from_string(std::string name) {
+    if(name == "uniform") return VOLK_DATA_UNIFORM;
+    if(name == "gaussian") return VOLK_DATA_GAUSSIAN;
+    if(name == "tone") return VOLK_DATA_TONE;
+    if(name == "qpsk") return VOLK_DATA_QPSK;
+    if(name == "denormal") return VOLK_DATA_DENORMAL;
+    if(name == "saturate") return VOLK_DATA_SATURATE;
+    throw std::string("unknown input data " + name + ", use uniform, gaussian, tone, qpsk, denormal or saturate");
+}
+
+std::string volk_test_data_to_string(volk_test_data_t dist) {
+    switch(dist) {
+    case VOLK_DATA_GAUSSIAN: return "gaussian";
+    case VOLK_DATA_TONE: return "tone";
+    case VOLK_DATA_QPSK: return "qpsk";
+    case VOLK_DATA_DENORMAL: return "denormal";
+    case VOLK_DATA_SATURATE: return "saturate";
+    default: return "uniform";
+    }
+}
+
+void load_random_data(void *data, volk_type_t type, unsigned int n, volk_test_data_t dist) {
+    if(dist != VOLK_DATA_UNIFORM) {
+        load_signal_data(data, type, n, dist);
+        return;
+    }
     if(type.is_complex) n *= 2;
     if(type.is_float) {
         if(type.size == 8) random_floats<double>((double *)data, n);
@@ -67,6 +202,80 @@ void load_random_data(void *data, volk_type_t type, unsigned int n) {
     }
 }
 
+volk_test_cache_t volk_test_cache_from_string(std::string name) {
+    if(name == "hot") return VOLK_CACHE_HOT;
+    if(name == "l2") return VOLK_CACHE_L2;
+    if(name == "l3") return VOLK_CACHE_L3;
+    if(name == "dram") return VOLK_CACHE_DRAM;
+    throw std::string("unknown cache mode " + name + ", use hot, l2, l3 or dram");
+}
+
+std::string volk_test_cache_to_string(volk_test_cache_t cache) {
+    switch(cache) {
+    case VOLK_CACHE_L2: return "l2";
+    case VOLK_CACHE_L3: return "l3";
+    case VOLK_CACHE_DRAM: return "dram";
+    default: return "hot";
+    }
+}
+
+// size in bytes of the data or unified cache of a level, as linux reports
+// it in sysfs; typical sizes where that is not available
+size_t volk_cache_size(unsigned int level) {
+    static const size_t fallback[] = {0, 32 << 10, 1 << 20, 32 << 20};
+    if(level < 1 || level > 3) return 0;
+
+    size_t size = 0;
+    for(unsigned int index = 0; ; index++) {
+        const std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" +
+            boost::lexical_cast<std::string>(index) + "/";
+        std::ifstream level_file((dir + "level").c_str());
+        std::ifstream type_file((dir + "type").c_str());
+        std::ifstream size_file((dir + "size").c_str());
+        if(!level_file.is_open()) break;
+
+        unsigned int cache_level = 0;
+        std::string type, size_str;
+        level_file >> cache_level;
+        type_file >> type;
+        size_file >> size_str;
+        if(cache_level != level || type == "Instruction" || size_str.empty()) continue;
+
+        size = strtoul(size_str.c_str(), NULL, 10);
+        switch(size_str[size_str.size()-1]) {
+        case 'K': size <<= 10; break;
+        case 'M': size <<= 20; break;
+        case 'G': size <<= 30; break;
+        }
+    }
+    return size ? size : fallback[level];
+}
+
+// one logical cpu of each physical core this process may run on, so no two
+// workers share a core through SMT
+std::vector<int> physical_cores()
+{
+    std::vector<int> cores;
+#if defined(__linux__)
+    cpu_set_t allowed;
+    if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return cores;
+
+    std::set<std::pair<int, int> > seen;
+    for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if(!CPU_ISSET(cpu, &allowed)) continue;
+        const std::string topology = "/sys/devices/system/cpu/cpu" +
+            boost::lexical_cast<std::string>(cpu) + "/topology/";
+        int package = 0, core = cpu;
+        std::ifstream package_file((topology + "physical_package_id").c_str());
+        std::ifstream core_file((topology + "core_id").c_str());
+        package_file >> package;
+        core_file >> core;
+        if(seen.insert(std::make_pair(package, core)).second) cores.push_back(cpu);
+    }
+#endif
+    return cores;
+}
+
 static std::vector<std::string> get_arch_list(volk_func_desc_t desc) {
     std::vector<std::string> archlist;
 
@@ -179,44 +388,435 @@ static void get_signatures_from_name(std::vector<volk_type_t> &inputsig,
 
 }
 
-inline void run_cast_test1(volk_fn_1arg func, std::vector<void *> &buffs, unsigned int vlen, unsigned int iter, std::string arch) {
-    while(iter--) func(buffs[0], vlen, arch.c_str());
+inline void run_cast_test1(volk_fn_1arg func, std::vector<void *> &buffs, unsigned int vlen, unsigned int iter, const char *arch) {
+    while(iter--) func(buffs[0], vlen, arch);
+}
+
+inline void run_cast_test2(volk_fn_2arg func, std::vector<void *> &buffs, unsigned int vlen, unsigned int iter, const char *arch) {
+    while(iter--) func(buffs[0], buffs[1], vlen, arch);
 }
 
-inline void run_cast_test2(volk_fn_2arg func, std::vector<void *> &buffs, unsigned int vlen, unsigned int iter, std::string arch) {
-    while(iter--) func(buffs[0], buffs[1], vlen, arch.c_str());
+inline void run_cast_test3(volk_fn_3arg func, std::vector<void *> &buffs, unsigned int vlen, unsigned int iter, const char *arch) {
+    while(iter--) func(buffs[0], buffs[1], buffs[2], vlen, arch);
 }
 
-inline void run_cast_test3(volk_fn_3arg func, std::vector<void *> &buffs, unsigned int vlen, unsigned int iter, std::string arch) {
-    while(iter--) func(buffs[0], buffs[1], buffs[2], vlen, arch.c_str());
+inline void run_cast_test4(volk_fn_4arg func, std::vector<void *> &buffs, unsigned int vlen, unsigned int iter, const char *arch) {
+    while(iter--) func(buffs[0], buffs[1], buffs[2], buffs[3], vlen, arch);
+}
+
+inline void run_cast_test1_s32f(volk_fn_1arg_s32f func, std::vector<void *> &buffs, float scalar, unsigned int vlen, unsigned int iter, const char *arch) {
+    while(iter--) func(buffs[0], scalar, vlen, arch);
+}
+
+inline void run_cast_test2_s32f(volk_fn_2arg_s32f func, std::vector<void *> &buffs, float scalar, unsigned int vlen, unsigned int iter, const char *arch) {
+    while(iter--) func(buffs[0], buffs[1], scalar, vlen, arch);
+}
+
+inline void run_cast_test3_s32f(volk_fn_3arg_s32f func, std::vector<void *> &buffs, float scalar, unsigned int vlen, unsigned int iter, const char *arch) {
+    while(iter--) func(buffs[0], buffs[1], buffs[2], scalar, vlen, arch);
+}
+
+inline void run_cast_test1_s32fc(volk_fn_1arg_s32fc func, std::vector<void *> &buffs, lv_32fc_t scalar, unsigned int vlen, unsigned int iter, const char *arch) {
+    while(iter--) func(buffs[0], scalar, vlen, arch);
+}
+
+inline void run_cast_test2_s32fc(volk_fn_2arg_s32fc func, std::vector<void *> &buffs, lv_32fc_t scalar, unsigned int vlen, unsigned int iter, const char *arch) {
+    while(iter--) func(buffs[0], buffs[1], scalar, vlen, arch);
+}
+
+inline void run_cast_test3_s32fc(volk_fn_3arg_s32fc func, std::vector<void *> &buffs, lv_32fc_t scalar, unsigned int vlen, unsigned int iter, const char *arch) {
+    while(iter--) func(buffs[0], buffs[1], buffs[2], scalar, vlen, arch);
+}
+
+// time stamp of the given timer, in ns for the monotonic clock
+static inline uint64_t volk_qa_ticks(volk_test_timer_t timer) {
+#ifdef VOLK_QA_HAVE_RDTSC
+    if(timer == VOLK_TIMER_RDTSC) return __rdtsc();
+#endif
+#if defined(_WIN32)
+    LARGE_INTEGER count, freq;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&freq);
+    return (uint64_t)(count.QuadPart * (1e9 / freq.QuadPart));
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+    return (uint64_t)((double)clock() * 1e9 / CLOCKS_PER_SEC);
+#endif
+}
+
+// run iter calls of one arch of the kernel under test
+static void run_arch_test(void (*manual_func)(), std::vector<volk_type_t> &both_sigs,
+                          std::vector<volk_type_t> &inputsc, std::vector<void *> &buffs,
+                          lv_32fc_t scalar, unsigned int vlen, unsigned int iter, const char *arch) {
+    switch(both_sigs.size()) {
+        case 1:
+            if(inputsc.size() == 0) {
+                run_cast_test1((volk_fn_1arg)(manual_func), buffs, vlen, iter, arch);
+            } else if(inputsc.size() == 1 && inputsc[0].is_float) {
+                if(inputsc[0].is_complex) {
+                    run_cast_test1_s32fc((volk_fn_1arg_s32fc)(manual_func), buffs, scalar, vlen, iter, arch);
+                } else {
+                    run_cast_test1_s32f((volk_fn_1arg_s32f)(manual_func), buffs, scalar.real(), vlen, iter, arch);
+                }
+            } else throw "unsupported 1 arg function >1 scalars";
+            break;
+        case 2:
+            if(inputsc.size() == 0) {
+                run_cast_test2((volk_fn_2arg)(manual_func), buffs, vlen, iter, arch);
+            } else if(inputsc.size() == 1 && inputsc[0].is_float) {
+                if(inputsc[0].is_complex) {
+                    run_cast_test2_s32fc((volk_fn_2arg_s32fc)(manual_func), buffs, scalar, vlen, iter, arch);
+                } else {
+                    run_cast_test2_s32f((volk_fn_2arg_s32f)(manual_func), buffs, scalar.real(), vlen, iter, arch);
+                }
+            } else throw "unsupported 2 arg function >1 scalars";
+            break;
+        case 3:
+            if(inputsc.size() == 0) {
+                run_cast_test3((volk_fn_3arg)(manual_func), buffs, vlen, iter, arch);
+            } else if(inputsc.size() == 1 && inputsc[0].is_float) {
+                if(inputsc[0].is_complex) {
+                    run_cast_test3_s32fc((volk_fn_3arg_s32fc)(manual_func), buffs, scalar, vlen, iter, arch);
+                } else {
+                    run_cast_test3_s32f((volk_fn_3arg_s32f)(manual_func), buffs, scalar.real(), vlen, iter, arch);
+                }
+            } else throw "unsupported 3 arg function >1 scalars";
+            break;
+        case 4:
+            run_cast_test4((volk_fn_4arg)(manual_func), buffs, vlen, iter, arch);
+            break;
+        default:
+            throw "no function handler for this signature";
+            break;
+    }
 }
 
-inline void run_cast_test4(volk_fn_4arg func, std::vector<void *> &buffs, unsigned int vlen, unsigned int iter, std::string arch) {
-    while(iter--) func(buffs[0], buffs[1], buffs[2], buffs[3], vlen, arch.c_str());
+// one call of the dispatcher or an impl, which take no impl name
+static void run_impl_call(void (*func)(), std::vector<volk_type_t> &both_sigs,
+                          std::vector<volk_type_t> &inputsc, std::vector<void *> &buffs,
+                          lv_32fc_t scalar, unsigned int vlen) {
+    switch(both_sigs.size()) {
+        case 1:
+            if(inputsc.size() == 0) {
+                ((volk_impl_1arg)func)(buffs[0], vlen);
+            } else if(inputsc.size() == 1 && inputsc[0].is_float) {
+                if(inputsc[0].is_complex) {
+                    ((volk_impl_1arg_s32fc)func)(buffs[0], scalar, vlen);
+                } else {
+                    ((volk_impl_1arg_s32f)func)(buffs[0], scalar.real(), vlen);
+                }
+            } else throw "unsupported 1 arg function >1 scalars";
+            break;
+        case 2:
+            if(inputsc.size() == 0) {
+                ((volk_impl_2arg)func)(buffs[0], buffs[1], vlen);
+            } else if(inputsc.size() == 1 && inputsc[0].is_float) {
+                if(inputsc[0].is_complex) {
+                    ((volk_impl_2arg_s32fc)func)(buffs[0], buffs[1], scalar, vlen);
+                } else {
+                    ((volk_impl_2arg_s32f)func)(buffs[0], buffs[1], scalar.real(), vlen);
+                }
+            } else throw "unsupported 2 arg function >1 scalars";
+            break;
+        case 3:
+            if(inputsc.size() == 0) {
+                ((volk_impl_3arg)func)(buffs[0], buffs[1], buffs[2], vlen);
+            } else if(inputsc.size() == 1 && inputsc[0].is_float) {
+                if(inputsc[0].is_complex) {
+                    ((volk_impl_3arg_s32fc)func)(buffs[0], buffs[1], buffs[2], scalar, vlen);
+                } else {
+                    ((volk_impl_3arg_s32f)func)(buffs[0], buffs[1], buffs[2], scalar.real(), vlen);
+                }
+            } else throw "unsupported 3 arg function >1 scalars";
+            break;
+        case 4:
+            ((volk_impl_4arg)func)(buffs[0], buffs[1], buffs[2], buffs[3], vlen);
+            break;
+        default:
+            throw "no function handler for this signature";
+            break;
+    }
 }
 
-inline void run_cast_test1_s32f(volk_fn_1arg_s32f func, std::vector<void *> &buffs, float scalar, unsigned int vlen, unsigned int iter, std::string arch) {
-    while(iter--) func(buffs[0], scalar, vlen, arch.c_str());
+#if !defined(_WIN32)
+// lets the threads of a contention run start their timed calls together
+class volk_qa_barrier {
+public:
+    volk_qa_barrier(unsigned int count) : _count(count), _waiting(0), _generation(0) {
+        pthread_mutex_init(&_mutex, NULL);
+        pthread_cond_init(&_cond, NULL);
+    }
+    ~volk_qa_barrier() {
+        pthread_cond_destroy(&_cond);
+        pthread_mutex_destroy(&_mutex);
+    }
+    void wait() {
+        pthread_mutex_lock(&_mutex);
+        const unsigned int generation = _generation;
+        if(++_waiting == _count) {
+            _waiting = 0;
+            _generation++;
+            pthread_cond_broadcast(&_cond);
+        }
+        else {
+            while(generation == _generation) pthread_cond_wait(&_cond, &_mutex);
+        }
+        pthread_mutex_unlock(&_mutex);
+    }
+    // a thread that will not arrive, as if it had
+    void drop() {
+        pthread_mutex_lock(&_mutex);
+        if(--_count == _waiting && _waiting > 0) {
+            _waiting = 0;
+            _generation++;
+            pthread_cond_broadcast(&_cond);
+        }
+        pthread_mutex_unlock(&_mutex);
+    }
+private:
+    pthread_mutex_t _mutex;
+    pthread_cond_t _cond;
+    unsigned int _count;
+    unsigned int _waiting;
+    unsigned int _generation;
+};
+#else
+class volk_qa_barrier {
+public:
+    volk_qa_barrier(unsigned int) {}
+    void wait() {}
+};
+#endif
+
+// hardware performance counters of the calling thread, see perf_event_open(2);
+// elsewhere than on linux nothing is counted and empty() is always true
+class volk_qa_counters {
+public:
+    volk_qa_counters(bool enabled) {
+#if defined(__linux__)
+        if(!enabled) return;
+        add("cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        add("instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        add("cache_references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES);
+        add("cache_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        add("l1d_read_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+            (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+        // CORE_POWER.LVL1/LVL2_TURBO_LICENSE, the cycles spent at the lower
+        // AVX frequency levels, on Skylake-SP and Cascade Lake
+        char cpu_model[64];
+        volk_get_cpu_model(cpu_model, sizeof(cpu_model));
+        if(strncmp(cpu_model, "GenuineIntel-6-85-", 18) == 0) {
+            add("license_l1_cycles", PERF_TYPE_RAW, 0x1828);
+            add("license_l2_cycles", PERF_TYPE_RAW, 0x2028);
+        }
+#endif
+    }
+    ~volk_qa_counters() {
+#if defined(__linux__)
+        for(size_t i = 0; i < _fds.size(); i++) close(_fds[i]);
+#endif
+    }
+    bool empty() const { return _fds.empty(); }
+    void start() {
+#if defined(__linux__)
+        for(size_t i = 0; i < _fds.size(); i++) {
+            ioctl(_fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+    void stop() {
+#if defined(__linux__)
+        for(size_t i = 0; i < _fds.size(); i++) ioctl(_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+#endif
+    }
+    // add the counts since start() to totals, scaled up when the kernel
+    // multiplexed the counters
+    void add_to(std::map<std::string, double> &totals) {
+#if defined(__linux__)
+        for(size_t i = 0; i < _fds.size(); i++) {
+            uint64_t values[3]; // value, time enabled, time running
+            if(read(_fds[i], values, sizeof(values)) != sizeof(values) || values[2] == 0) continue;
+            totals[_names[i]] += (double)values[0] * values[1] / values[2];
+        }
+#else
+        (void)totals;
+#endif
+    }
+private:
+#if defined(__linux__)
+    void add(const char *name, uint32_t type, uint64_t config) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        const int fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        if(fd < 0) return;
+        _fds.push_back(fd);
+        _names.push_back(name);
+    }
+#endif
+    std::vector<int> _fds;
+    std::vector<std::string> _names;
+};
+
+// the calls of one thread to an arch under test
+struct volk_qa_timed_calls {
+    void (*manual_func)();
+    void (*impl_func)();      // the arch resolved up front, or NULL to call it by name
+    std::vector<volk_type_t> *both_sigs;
+    std::vector<volk_type_t> *inputsc;
+    std::vector<std::vector<void *> > sets; // buffers to rotate over
+    lv_32fc_t scalar;
+    unsigned int vlen;
+    unsigned int warmup;
+    unsigned int iter;
+    std::string arch;
+    volk_test_timer_t timer;
+    int cpu;                  // cpu to pin the thread to, or -1
+    volk_qa_barrier *barrier; // start of the timed calls, or NULL
+    bool counters;            // count hardware events of the timed calls
+    std::map<std::string, double> counts;
+    std::vector<double> samples;
+    uint64_t total;
+    double wall_ns;           // monotonic time of all timed calls
+};
+
+// one call of the arch, directly when it was resolved
+static inline void run_timed_call(volk_qa_timed_calls &calls, std::vector<void *> &buffs) {
+    if(calls.impl_func != NULL) {
+        run_impl_call(calls.impl_func, *calls.both_sigs, *calls.inputsc, buffs, calls.scalar, calls.vlen);
+    }
+    else {
+        run_arch_test(calls.manual_func, *calls.both_sigs, *calls.inputsc, buffs,
+                      calls.scalar, calls.vlen, 1, calls.arch.c_str());
+    }
 }
 
-inline void run_cast_test2_s32f(volk_fn_2arg_s32f func, std::vector<void *> &buffs, float scalar, unsigned int vlen, unsigned int iter, std::string arch) {
-    while(iter--) func(buffs[0], buffs[1], scalar, vlen, arch.c_str());
+static void run_timed_calls(volk_qa_timed_calls &calls) {
+    const size_t n_sets = calls.sets.size();
+
+    // warm up branch predictors and cpu clocks before timing
+    for(unsigned int it = 0; it < calls.warmup; it++) {
+        run_timed_call(calls, calls.sets[it % n_sets]);
+    }
+    if(calls.barrier != NULL) calls.barrier->wait();
+
+    // opened by the thread itself, the counters follow only this thread
+    volk_qa_counters counters(calls.counters);
+
+    calls.samples.resize(calls.iter);
+    calls.total = 0;
+    counters.start();
+    const uint64_t wall_start = volk_qa_ticks(VOLK_TIMER_MONOTONIC);
+    for(unsigned int it = 0; it < calls.iter; it++) {
+        std::vector<void *> &buffs = calls.sets[(calls.warmup + it) % n_sets];
+        const uint64_t start = volk_qa_ticks(calls.timer);
+        run_timed_call(calls, buffs);
+        const uint64_t end = volk_qa_ticks(calls.timer);
+        calls.samples[it] = (double)(end - start);
+        calls.total += end - start;
+    }
+    calls.wall_ns = (double)(volk_qa_ticks(VOLK_TIMER_MONOTONIC) - wall_start);
+    counters.stop();
+    counters.add_to(calls.counts);
 }
 
-inline void run_cast_test3_s32f(volk_fn_3arg_s32f func, std::vector<void *> &buffs, float scalar, unsigned int vlen, unsigned int iter, std::string arch) {
-    while(iter--) func(buffs[0], buffs[1], buffs[2], scalar, vlen, arch.c_str());
+#if !defined(_WIN32)
+static void *run_timed_thread(void *arg) {
+    volk_qa_timed_calls &calls = *(volk_qa_timed_calls *)arg;
+#if defined(__linux__)
+    if(calls.cpu >= 0) {
+        cpu_set_t cpu;
+        CPU_ZERO(&cpu);
+        CPU_SET(calls.cpu, &cpu);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu), &cpu);
+    }
+#endif
+    try {
+        run_timed_calls(calls);
+    }
+    catch (...) {
+        // the results of this thread stay empty
+    }
+    return NULL;
 }
+#endif
 
-inline void run_cast_test1_s32fc(volk_fn_1arg_s32fc func, std::vector<void *> &buffs, lv_32fc_t scalar, unsigned int vlen, unsigned int iter, std::string arch) {
-    while(iter--) func(buffs[0], scalar, vlen, arch.c_str());
+// run the calls of every thread at the same time, a single one inline
+static void run_timed_threads(std::vector<volk_qa_timed_calls> &threads) {
+    for(size_t thread = 0; thread < threads.size(); thread++) {
+        threads[thread].samples.clear();
+        threads[thread].total = 0;
+        threads[thread].wall_ns = 0;
+        threads[thread].barrier = NULL;
+        threads[thread].counts.clear();
+    }
+    if(threads.size() == 1) {
+        run_timed_calls(threads[0]);
+        return;
+    }
+#if !defined(_WIN32)
+    volk_qa_barrier barrier(threads.size());
+    std::vector<pthread_t> ids;
+    for(size_t thread = 0; thread < threads.size(); thread++) {
+        pthread_t id;
+        threads[thread].barrier = &barrier;
+        if(pthread_create(&id, NULL, &run_timed_thread, &threads[thread]) != 0) {
+            // release the threads that are already waiting
+            for(size_t missing = thread; missing < threads.size(); missing++) barrier.drop();
+            break;
+        }
+        ids.push_back(id);
+    }
+    for(size_t thread = 0; thread < ids.size(); thread++) {
+        pthread_join(ids[thread], NULL);
+    }
+    if(ids.size() < threads.size()) throw std::string("could not start the benchmark threads");
+#endif
 }
 
-inline void run_cast_test2_s32fc(volk_fn_2arg_s32fc func, std::vector<void *> &buffs, lv_32fc_t scalar, unsigned int vlen, unsigned int iter, std::string arch) {
-    while(iter--) func(buffs[0], buffs[1], scalar, vlen, arch.c_str());
+// fill in the statistics of the per call times
+static void compute_time_stats(volk_test_time_t &result, std::vector<double> samples) {
+    result.samples = samples.size();
+    if(samples.empty()) {
+        result.min = result.median = result.p99 = result.mean = 0;
+        result.ci_low = result.ci_high = 0;
+        return;
+    }
+    std::sort(samples.begin(), samples.end());
+    const size_t n = samples.size();
+    result.min = samples.front();
+    result.median = (n % 2)? samples[n/2] : (samples[n/2 - 1] + samples[n/2]) / 2;
+    result.p99 = samples[std::min(n - 1, (size_t)std::ceil(0.99 * n) - 1)];
+    result.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / n;
+
+    // distribution free interval from the order statistics around the median
+    const double spread = 1.96 * std::sqrt((double)n) / 2;
+    const double low = std::floor(n / 2.0 - spread);
+    const double high = std::ceil(n / 2.0 + spread);
+    result.ci_low = samples[low < 0 ? 0 : (size_t)low];
+    result.ci_high = samples[high > n - 1 ? n - 1 : (size_t)high];
 }
 
-inline void run_cast_test3_s32fc(volk_fn_3arg_s32fc func, std::vector<void *> &buffs, lv_32fc_t scalar, unsigned int vlen, unsigned int iter, std::string arch) {
-    while(iter--) func(buffs[0], buffs[1], buffs[2], scalar, vlen, arch.c_str());
+// bin the calls up to the 99th percentile, the last bin holds the rest
+static void compute_histogram(volk_test_time_t &result, const std::vector<double> &samples) {
+    const size_t n_bins = 20;
+    result.histogram.assign(n_bins + 1, 0);
+    result.histogram_start = result.min;
+    result.histogram_width = std::max((result.p99 - result.min) / n_bins, 1.0);
+    for(size_t i = 0; i < samples.size(); i++) {
+        const size_t bin = (size_t)((samples[i] - result.histogram_start) / result.histogram_width);
+        result.histogram[std::min(bin, n_bins)]++;
+    }
 }
 
 template <class t>
@@ -283,6 +883,154 @@ bool ccompare(t *in1, t *in2, unsigned int vlen, float tol) {
     return fail;
 }
 
+// errors of the float outputs of one impl, summed in double precision;
+// outputs that are nan or inf where the reference is not (or the other
+// way round) are only counted, they have no finite distance to add
+struct volk_qa_error {
+    double max_ulp, sum_ulp, max_rel, sum_rel;
+    size_t n_ulp, n_rel, n_nonfinite;
+    volk_qa_error() : max_ulp(0), sum_ulp(0), max_rel(0), sum_rel(0), n_ulp(0), n_rel(0),
+        n_nonfinite(0) {}
+};
+
+// position of a float among all floats, so that neighbours differ by one
+template <class t, class bits_t>
+double ordered_bits(t value) {
+    bits_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const double magnitude = (double)(bits & std::numeric_limits<bits_t>::max());
+    return (bits < 0) ? -magnitude : magnitude;
+}
+
+static double ulp_distance(float a, float b) {
+    return std::fabs(ordered_bits<float, int32_t>(a) - ordered_bits<float, int32_t>(b));
+}
+
+static double ulp_distance(double a, double b) {
+    return std::fabs(ordered_bits<double, int64_t>(a) - ordered_bits<double, int64_t>(b));
+}
+
+// the same nan, or the same infinity, counts as no error
+template <class t>
+bool nonfinite_match(t ref, t out) {
+    if(std::isnan(ref) || std::isnan(out)) return std::isnan(ref) && std::isnan(out);
+    return ref == out;
+}
+
+template <class t>
+void measure_error(t *ref, t *out, unsigned int vlen, bool is_complex, volk_qa_error *err) {
+    const unsigned int n = is_complex ? 2 * vlen : vlen;
+    for(unsigned int i = 0; i < n; i++) {
+        if(!std::isfinite(ref[i]) || !std::isfinite(out[i])) {
+            if(!nonfinite_match(ref[i], out[i])) err->n_nonfinite++;
+            continue;
+        }
+        const double ulp = ulp_distance(ref[i], out[i]);
+        err->max_ulp = std::max(err->max_ulp, ulp);
+        err->sum_ulp += ulp;
+        err->n_ulp++;
+    }
+    // complex samples have one error relative to their magnitude
+    const unsigned int step = is_complex ? 2 : 1;
+    for(unsigned int i = 0; i < n; i += step) {
+        double diff = (double)out[i] - (double)ref[i];
+        double norm = (double)ref[i] * (double)ref[i];
+        if(is_complex) {
+            const double diff_q = (double)out[i+1] - (double)ref[i+1];
+            diff = std::sqrt(diff * diff + diff_q * diff_q);
+            norm = std::sqrt(norm + (double)ref[i+1] * (double)ref[i+1]);
+        }
+        else {
+            diff = std::fabs(diff);
+            norm = std::sqrt(norm);
+        }
+        // like the compare functions, tiny references have no relative
+        // error; nan and inf were counted above
+        if(!(norm >= 1e-30) || !std::isfinite(norm) || !std::isfinite(diff)) continue;
+        const double rel = diff / norm;
+        err->max_rel = std::max(err->max_rel, rel);
+        err->sum_rel += rel;
+        err->n_rel++;
+    }
+}
+
+// errors of float outputs against a reference in double precision, in ulp
+// of the float nearest to the reference, so a correctly rounded output is
+// at most half an ulp off
+static void measure_reference_error(const double *ref, const float *out, unsigned int n, volk_qa_error *err) {
+    for(unsigned int i = 0; i < n; i++) {
+        const float nearest = (float)ref[i];
+        if(!std::isfinite(nearest) || !std::isfinite(out[i])) {
+            if(!nonfinite_match(nearest, out[i])) err->n_nonfinite++;
+            continue;
+        }
+        const float magnitude = std::fabs(nearest);
+        const double spacing = (magnitude < std::numeric_limits<float>::max())?
+            (double)nextafterf(magnitude, std::numeric_limits<float>::infinity()) - magnitude :
+            magnitude - (double)nextafterf(magnitude, 0);
+        const double diff = std::fabs((double)out[i] - ref[i]);
+        const double ulp = diff / spacing;
+        err->max_ulp = std::max(err->max_ulp, ulp);
+        err->sum_ulp += ulp;
+        err->n_ulp++;
+        if(!(std::fabs(ref[i]) >= 1e-30)) continue;
+        const double rel = diff / std::fabs(ref[i]);
+        err->max_rel = std::max(err->max_rel, rel);
+        err->sum_rel += rel;
+        err->n_rel++;
+    }
+}
+
+static double qa_log2(double x) { return std::log(x) / std::log(2.0); }
+
+// float kernels of one input that compute a libm function. Their generic
+// impls are approximations too, so their error is measured against the
+// function in double precision, on the test data and over a sweep of the
+// finite inputs with finite results (normal ones for the logarithm and the
+// root, denormals are what --data denormal is for)
+struct volk_qa_reference_t {
+    const char *name;
+    double (*func)(double);
+    float lo, hi;
+};
+
+static const volk_qa_reference_t volk_qa_references[] = {
+    {"volk_32f_sin_32f", std::sin, -std::numeric_limits<float>::max(), std::numeric_limits<float>::max()},
+    {"volk_32f_cos_32f", std::cos, -std::numeric_limits<float>::max(), std::numeric_limits<float>::max()},
+    {"volk_32f_tan_32f", std::tan, -std::numeric_limits<float>::max(), std::numeric_limits<float>::max()},
+    {"volk_32f_atan_32f", std::atan, -std::numeric_limits<float>::max(), std::numeric_limits<float>::max()},
+    {"volk_32f_asin_32f", std::asin, -1.0f, 1.0f},
+    {"volk_32f_acos_32f", std::acos, -1.0f, 1.0f},
+    {"volk_32f_tanh_32f", std::tanh, -std::numeric_limits<float>::max(), std::numeric_limits<float>::max()},
+    {"volk_32f_log2_32f", qa_log2, std::numeric_limits<float>::min(), std::numeric_limits<float>::max()},
+    {"volk_32f_expfast_32f", std::exp, -87.0f, 88.0f},
+    {"volk_32f_sqrt_32f", std::sqrt, std::numeric_limits<float>::min(), std::numeric_limits<float>::max()},
+};
+
+static const volk_qa_reference_t *find_reference(const std::string &name) {
+    for(size_t i = 0; i < sizeof(volk_qa_references) / sizeof(volk_qa_references[0]); i++) {
+        if(name == volk_qa_references[i].name) return &volk_qa_references[i];
+    }
+    return NULL;
+}
+
+// points of the domain sweep, independent of the vector length tested
+static const unsigned int volk_qa_domain_points = 65536;
+
+// floats evenly spaced in their order from lo to hi, so that every binade
+// of the domain gets the same number of points
+static void fill_domain_sweep(float *buff, float lo, float hi, unsigned int n) {
+    const double first = ordered_bits<float, int32_t>(lo);
+    const double last = ordered_bits<float, int32_t>(hi);
+    for(unsigned int k = 0; k < n; k++) {
+        const double position = (n > 1)? first + (last - first) * k / (n - 1) : first;
+        const int32_t bits = (int32_t)(std::fabs(position) + 0.5);
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        buff[k] = (position < 0)? -value : value;
+    }
+}
+
 template <class t>
 bool icompare(t *in1, t *in2, unsigned int vlen, unsigned int tol) {
     bool fail = false;
@@ -305,6 +1053,7 @@ public:
     void *get_new(size_t size){
         size_t alignment = volk_get_alignment();
         void* ptr = volk_malloc(size, alignment);
+        if(ptr == NULL) throw std::string("out of memory for the test buffers");
         memset(ptr, 0x00, size);
         _mems.push_back(ptr);
         return ptr;
@@ -317,19 +1066,6 @@ public:
 private: std::vector<void * > _mems;
 };
 
-bool run_volk_tests(volk_func_desc_t desc,
-                    void (*manual_func)(),
-                    std::string name,
-                    volk_test_params_t test_params,
-                    std::vector<volk_test_results_t> *results,
-                    std::string puppet_master_name
-)
-{
-    return run_volk_tests(desc, manual_func, name, test_params.tol(), test_params.scalar(),
-        test_params.vlen(), test_params.iter(), results, puppet_master_name,
-        test_params.benchmark_mode());
-}
-
 bool run_volk_tests(volk_func_desc_t desc,
                     void (*manual_func)(),
                     std::string name,
@@ -341,6 +1077,30 @@ bool run_volk_tests(volk_func_desc_t desc,
                     std::string puppet_master_name,
                     bool benchmark_mode
 ) {
+    return run_volk_tests(desc, manual_func, name,
+        volk_test_params_t(tol, scalar, vlen, iter, benchmark_mode, ".*"),
+        results, puppet_master_name);
+}
+
+bool run_volk_tests(volk_func_desc_t desc,
+                    void (*manual_func)(),
+                    std::string name,
+                    volk_test_params_t test_params,
+                    std::vector<volk_test_results_t> *results,
+                    std::string puppet_master_name,
+                    volk_fn_get_impl get_impl
+)
+{
+    const float tol = test_params.tol();
+    const lv_32fc_t scalar = test_params.scalar();
+    unsigned int vlen = test_params.vlen();
+    const unsigned int iter = test_params.iter();
+    const bool benchmark_mode = test_params.benchmark_mode();
+    const unsigned int warmup = test_params.warmup();
+    volk_test_timer_t timer = test_params.timer();
+    const volk_test_cache_t cache = test_params.cache();
+    unsigned int n_threads = test_params.threads();
+
     // Initialize this entry in results vector
     results->push_back(volk_test_results_t());
     results->back().name = name;
@@ -394,7 +1154,7 @@ bool run_volk_tests(volk_func_desc_t desc,
           inbuffs.push_back(mem_pool.get_new(vlen*sig.size*(sig.is_complex ? 2 : 1)));
     }
     for(size_t i=0; i<inbuffs.size(); i++) {
-        load_random_data(inbuffs[i], inputsig[i], vlen);
+        load_random_data(inbuffs[i], inputsig[i], vlen, test_params.data());
     }
 
     //ok let's make a vector of vector of void buffers, which holds the input/output vectors for each arch
@@ -416,66 +1176,140 @@ bool run_volk_tests(volk_func_desc_t desc,
     both_sigs.insert(both_sigs.end(), outputsig.begin(), outputsig.end());
     both_sigs.insert(both_sigs.end(), inputsig.begin(), inputsig.end());
 
+    // reductions have short outputs, count them as full vectors anyway
+    results->back().bytes_per_point = 0;
+    BOOST_FOREACH(volk_type_t sig, both_sigs) {
+        results->back().bytes_per_point += sig.size * (sig.is_complex ? 2 : 1);
+    }
+
+    // the cold cache modes rotate each arch over enough copies of its
+    // buffers to exceed twice the cache level above the one to measure
+    std::vector<size_t> buff_sizes;
+    size_t set_bytes = 0;
+    BOOST_FOREACH(volk_type_t sig, both_sigs) {
+        buff_sizes.push_back(vlen * sig.size * (sig.is_complex ? 2 : 1));
+        set_bytes += buff_sizes.back();
+    }
+    size_t n_sets = 1;
+    if(cache != VOLK_CACHE_HOT && set_bytes > 0) {
+        const size_t evict_bytes = 2 * volk_cache_size((unsigned int)cache);
+        n_sets = std::max<size_t>(1, (evict_bytes + set_bytes - 1) / set_bytes);
+    }
+    results->back().cache_mode = volk_test_cache_to_string(cache);
+    results->back().data = volk_test_data_to_string(test_params.data());
+    results->back().threads = n_threads;
+    results->back().working_set = n_sets * set_bytes;
+
     //now run the test
     vlen = vlen - vlen_twiddle;
-    clock_t start, end;
+#ifndef VOLK_QA_HAVE_RDTSC
+    timer = VOLK_TIMER_MONOTONIC;
+#endif
+#if defined(_WIN32)
+    n_threads = 1;
+#endif
+    if(n_threads < 1) n_threads = 1;
+    std::vector<int> cores;
+    if(n_threads > 1) cores = physical_cores();
+
+    const double ticks_per_ms = (timer == VOLK_TIMER_RDTSC)? 0 : 1e6;
+    static bool counters_warned = false;
     std::vector<double> profile_times;
     for(size_t i = 0; i < arch_list.size(); i++) {
-        start = clock();
+        // copies of the arch buffers for each set and thread, the first set
+        // of the first thread is the one compared later
+        volk_qa_aligned_mem_pool rotation_pool;
+        std::vector<volk_qa_timed_calls> threads(n_threads);
+        for(unsigned int thread = 0; thread < n_threads; thread++) {
+            volk_qa_timed_calls &calls = threads[thread];
+            for(size_t set = 0; set < n_sets; set++) {
+                if(thread == 0 && set == 0) {
+                    calls.sets.push_back(test_data[i]);
+                    continue;
+                }
+                std::vector<void *> set_buffs;
+                for(size_t j = 0; j < buff_sizes.size(); j++) {
+                    set_buffs.push_back(rotation_pool.get_new(buff_sizes[j]));
+                    memcpy(set_buffs.back(), test_data[i][j], buff_sizes[j]);
+                }
+                calls.sets.push_back(set_buffs);
+            }
+            calls.manual_func = manual_func;
+            calls.impl_func = (get_impl != NULL)? get_impl(arch_list[i].c_str(), NULL) : NULL;
+            calls.both_sigs = &both_sigs;
+            calls.inputsc = &inputsc;
+            calls.scalar = scalar;
+            calls.vlen = vlen;
+            calls.warmup = warmup;
+            calls.iter = iter;
+            calls.arch = arch_list[i];
+            calls.timer = timer;
+            calls.counters = test_params.counters();
+            calls.cpu = cores.empty()? -1 : cores[thread % cores.size()];
+        }
+        run_timed_threads(threads);
 
-        switch(both_sigs.size()) {
-            case 1:
-                if(inputsc.size() == 0) {
-                    run_cast_test1((volk_fn_1arg)(manual_func), test_data[i], vlen, iter, arch_list[i]);
-                } else if(inputsc.size() == 1 && inputsc[0].is_float) {
-                    if(inputsc[0].is_complex) {
-                        run_cast_test1_s32fc((volk_fn_1arg_s32fc)(manual_func), test_data[i], scalar, vlen, iter, arch_list[i]);
-                    } else {
-                        run_cast_test1_s32f((volk_fn_1arg_s32f)(manual_func), test_data[i], scalar.real(), vlen, iter, arch_list[i]);
-                    }
-                } else throw "unsupported 1 arg function >1 scalars";
-                break;
-            case 2:
-                if(inputsc.size() == 0) {
-                    run_cast_test2((volk_fn_2arg)(manual_func), test_data[i], vlen, iter, arch_list[i]);
-                } else if(inputsc.size() == 1 && inputsc[0].is_float) {
-                    if(inputsc[0].is_complex) {
-                        run_cast_test2_s32fc((volk_fn_2arg_s32fc)(manual_func), test_data[i], scalar, vlen, iter, arch_list[i]);
-                    } else {
-                        run_cast_test2_s32f((volk_fn_2arg_s32f)(manual_func), test_data[i], scalar.real(), vlen, iter, arch_list[i]);
-                    }
-                } else throw "unsupported 2 arg function >1 scalars";
-                break;
-            case 3:
-                if(inputsc.size() == 0) {
-                    run_cast_test3((volk_fn_3arg)(manual_func), test_data[i], vlen, iter, arch_list[i]);
-                } else if(inputsc.size() == 1 && inputsc[0].is_float) {
-                    if(inputsc[0].is_complex) {
-                        run_cast_test3_s32fc((volk_fn_3arg_s32fc)(manual_func), test_data[i], scalar, vlen, iter, arch_list[i]);
-                    } else {
-                        run_cast_test3_s32f((volk_fn_3arg_s32f)(manual_func), test_data[i], scalar.real(), vlen, iter, arch_list[i]);
-                    }
-                } else throw "unsupported 3 arg function >1 scalars";
-                break;
-            case 4:
-                run_cast_test4((volk_fn_4arg)(manual_func), test_data[i], vlen, iter, arch_list[i]);
-                break;
-            default:
-                throw "no function handler for this signature";
-                break;
+        // pool the calls of all threads
+        std::vector<double> samples;
+        std::map<std::string, double> counts;
+        uint64_t total = 0;
+        for(unsigned int thread = 0; thread < n_threads; thread++) {
+            samples.insert(samples.end(), threads[thread].samples.begin(), threads[thread].samples.end());
+            total += threads[thread].total;
+            std::map<std::string, double>::const_iterator count;
+            for(count = threads[thread].counts.begin(); count != threads[thread].counts.end(); ++count) {
+                counts[count->first] += count->second;
+            }
         }
+        total /= n_threads;
 
-        end = clock();
-        double arch_time = 1000.0 * (double)(end-start)/(double)CLOCKS_PER_SEC;
-        std::cout << arch_list[i] << " completed in " << arch_time << "ms" << std::endl;
         volk_test_time_t result;
         result.name = arch_list[i];
-        result.time = arch_time;
-        result.units = "ms";
+        result.time = ticks_per_ms ? total / ticks_per_ms : (double)total;
+        result.units = ticks_per_ms ? "ms" : "ticks";
         result.pass = true;
+        result.stat_units = ticks_per_ms ? "ns" : "ticks";
+        compute_time_stats(result, samples);
+        std::cout << arch_list[i] << " completed in " << result.time << result.units
+                  << ", median " << result.median << result.stat_units
+                  << " [" << result.ci_low << ", " << result.ci_high << "]"
+                  << " min " << result.min << " p99 " << result.p99 << std::endl;
+
+        // hardware events per call
+        if(!counts.empty() && !samples.empty()) {
+            std::map<std::string, double>::const_iterator count;
+            for(count = counts.begin(); count != counts.end(); ++count) {
+                result.counters[count->first] = count->second / samples.size();
+            }
+            if(counts.count("cycles") && counts.count("instructions") && counts["cycles"] > 0) {
+                result.counters["ipc"] = counts["instructions"] / counts["cycles"];
+            }
+            std::cout << " ";
+            for(count = result.counters.begin(); count != result.counters.end(); ++count) {
+                std::cout << " " << count->first << " " << count->second;
+            }
+            std::cout << std::endl;
+        }
+        else if(test_params.counters() && !counters_warned) {
+            std::cerr << "Warning: no hardware counters are available, check perf_event_paranoid" << std::endl;
+            counters_warned = true;
+        }
+
+        if(n_threads > 1) {
+            double aggregate = 0;
+            std::cout << "  samples/s per thread:";
+            for(unsigned int thread = 0; thread < n_threads; thread++) {
+                const double wall_ns = threads[thread].wall_ns;
+                result.thread_throughput.push_back(wall_ns > 0 ? 1e9 * iter * vlen / wall_ns : 0);
+                aggregate += result.thread_throughput.back();
+                std::cout << " " << result.thread_throughput.back();
+            }
+            std::cout << ", aggregate " << aggregate << std::endl;
+        }
         results->back().results[result.name] = result;
 
-        profile_times.push_back(arch_time);
+        // the median of the single calls is not skewed by interrupts
+        profile_times.push_back(result.median);
     }
 
     //and now compare each output to the generic output
@@ -492,11 +1326,86 @@ bool run_volk_tests(volk_func_desc_t desc,
     bool fail;
     bool fail_global = false;
     std::vector<bool> arch_results;
+    const bool accuracy_budget = (test_params.max_ulp() > 0 || test_params.max_rel_err() > 0);
+
+    // the double precision reference of libm backed kernels, for the points
+    // the kernels computed and for the domain sweep
+    const volk_qa_reference_t *reference = find_reference(name);
+    const unsigned int n_ref = vlen - vlen_twiddle;
+    std::vector<double> data_ref, domain_ref;
+    float *domain_in = NULL;
+    if(reference) {
+        for(unsigned int k = 0; k < n_ref; k++) {
+            data_ref.push_back(reference->func(((float *) inbuffs[0])[k]));
+        }
+        domain_in = (float *) mem_pool.get_new(volk_qa_domain_points * sizeof(float));
+        fill_domain_sweep(domain_in, reference->lo, reference->hi, volk_qa_domain_points);
+        for(unsigned int k = 0; k < volk_qa_domain_points; k++) {
+            domain_ref.push_back(reference->func(domain_in[k]));
+        }
+    }
+
     for(size_t i=0; i<arch_list.size(); i++) {
         fail = false;
+        volk_qa_error error, domain_error;
+        bool has_float = false;
+        if(reference) {
+            has_float = true;
+            measure_reference_error(&data_ref[0], (float *) test_data[i][0], n_ref, &error);
+            std::vector<void *> domain_buffs;
+            domain_buffs.push_back(mem_pool.get_new(volk_qa_domain_points * sizeof(float)));
+            domain_buffs.push_back(domain_in);
+            run_arch_test(manual_func, both_sigs, inputsc, domain_buffs, scalar,
+                          volk_qa_domain_points, 1, arch_list[i].c_str());
+            measure_reference_error(&domain_ref[0], (float *) domain_buffs[0], volk_qa_domain_points, &domain_error);
+        }
+        else {
+            for(size_t j=0; j<both_sigs.size(); j++) {
+                if(!both_sigs[j].is_float) continue;
+                has_float = true;
+                if(both_sigs[j].size == 8) {
+                    measure_error((double *) test_data[generic_offset][j], (double *) test_data[i][j],
+                                  vlen, both_sigs[j].is_complex, &error);
+                } else {
+                    measure_error((float *) test_data[generic_offset][j], (float *) test_data[i][j],
+                                  vlen, both_sigs[j].is_complex, &error);
+                }
+            }
+        }
+        if(has_float) {
+            volk_test_time_t *result = &results->back().results[arch_list[i]];
+            result->error_reference = reference ? "double" : "generic";
+            result->max_ulp = error.max_ulp;
+            result->mean_ulp = error.n_ulp ? error.sum_ulp / error.n_ulp : 0;
+            result->max_rel_err = error.max_rel;
+            result->mean_rel_err = error.n_rel ? error.sum_rel / error.n_rel : 0;
+            result->nonfinite_mismatches = error.n_nonfinite;
+            if(reference) {
+                result->domain_max_ulp = domain_error.max_ulp;
+                result->domain_mean_ulp = domain_error.n_ulp ? domain_error.sum_ulp / domain_error.n_ulp : 0;
+                result->domain_max_rel_err = domain_error.max_rel;
+                result->domain_nonfinite_mismatches = domain_error.n_nonfinite;
+            }
+            if(reference || i != generic_offset) {
+                std::cout << arch_list[i] << " error against " << result->error_reference << ": max "
+                          << result->max_ulp << " ulp, mean " << result->mean_ulp << " ulp, max relative "
+                          << result->max_rel_err;
+                if(error.n_nonfinite) std::cout << ", " << error.n_nonfinite << " nan/inf mismatches";
+                std::cout << std::endl;
+            }
+            if(reference) {
+                std::cout << arch_list[i] << " error over the input domain: max " << result->domain_max_ulp
+                          << " ulp, mean " << result->domain_mean_ulp << " ulp, max relative "
+                          << result->domain_max_rel_err;
+                if(domain_error.n_nonfinite) std::cout << ", " << domain_error.n_nonfinite << " nan/inf mismatches";
+                std::cout << std::endl;
+            }
+        }
         if(i != generic_offset) {
             for(size_t j=0; j<both_sigs.size(); j++) {
-                if(both_sigs[j].is_float) {
+                if(both_sigs[j].is_float && accuracy_budget) {
+                    // checked against the budget below
+                } else if(both_sigs[j].is_float) {
                     if(both_sigs[j].size == 8) {
                         if (both_sigs[j].is_complex) {
                             fail = ccompare((double *) test_data[generic_offset][j], (double *) test_data[i][j], vlen, tol_f);
@@ -563,6 +1472,16 @@ bool run_volk_tests(volk_func_desc_t desc,
                     std::cout << name << ": fail on arch " << arch_list[i] << std::endl;
                 }
             }
+            const double max_ulp = std::max(error.max_ulp, domain_error.max_ulp);
+            const double max_rel = std::max(error.max_rel, domain_error.max_rel);
+            if(has_float && accuracy_budget && (error.n_nonfinite + domain_error.n_nonfinite > 0 ||
+               (test_params.max_ulp() > 0 && max_ulp > test_params.max_ulp()) ||
+                (test_params.max_rel_err() > 0 && max_rel > test_params.max_rel_err()))) {
+                fail = true;
+                results->back().results[arch_list[i]].pass = false;
+                fail_global = true;
+                std::cout << name << ": arch " << arch_list[i] << " exceeds the accuracy budget" << std::endl;
+            }
         }
         arch_results.push_back(!fail);
     }
@@ -598,3 +1517,145 @@ bool run_volk_tests(volk_func_desc_t desc,
 
     return fail_global;
 }
+
+// per call latency of a kernel at a short vector length, through the
+// public function pointer, through <kernel>_manual and calling each impl
+bool run_volk_latency(volk_test_case_t test_case, std::vector<volk_test_results_t> *results) {
+    volk_test_params_t test_params = test_case.test_parameters();
+    const unsigned int vlen = test_params.vlen();
+    const unsigned int iter = test_params.iter();
+    volk_test_timer_t timer = test_params.timer();
+#ifndef VOLK_QA_HAVE_RDTSC
+    timer = VOLK_TIMER_MONOTONIC;
+#endif
+    const std::string units = (timer == VOLK_TIMER_RDTSC)? "ticks" : "ns";
+
+    if(test_case.get_impl() == NULL) {
+        std::cerr << "Error: no get_impl for " << test_case.name() << std::endl;
+        return false;
+    }
+
+    results->push_back(volk_test_results_t());
+    volk_test_results_t &kernel_result = results->back();
+    kernel_result.name = test_case.name();
+    kernel_result.config_name = (test_case.puppet_master_name() == "NULL")?
+        test_case.name() : test_case.puppet_master_name();
+    kernel_result.vlen = vlen;
+    kernel_result.iter = iter;
+    kernel_result.cache_mode = "hot";
+    kernel_result.data = volk_test_data_to_string(test_params.data());
+    std::cout << "RUN_VOLK_LATENCY: " << test_case.name() << "(" << vlen << "," << iter << ")" << std::endl;
+
+    std::vector<volk_type_t> inputsig, outputsig;
+    try {
+        get_signatures_from_name(inputsig, outputsig, test_case.name());
+    }
+    catch (boost::bad_lexical_cast& error) {
+        std::cerr << "Error: unable to get function signature from kernel name" << std::endl;
+        std::cerr << "  - " << test_case.name() << std::endl;
+        return false;
+    }
+    std::vector<volk_type_t> inputsc;
+    for(size_t i=0; i<inputsig.size(); i++) {
+        if(inputsig[i].is_scalar) {
+            inputsc.push_back(inputsig[i]);
+            inputsig.erase(inputsig.begin() + i);
+            i -= 1;
+        }
+    }
+
+    // the inputs are restored before every call, so in place kernels keep
+    // working on the same data
+    volk_qa_aligned_mem_pool mem_pool;
+    std::vector<volk_type_t> both_sigs;
+    both_sigs.insert(both_sigs.end(), outputsig.begin(), outputsig.end());
+    both_sigs.insert(both_sigs.end(), inputsig.begin(), inputsig.end());
+    std::vector<void *> buffs, inputs;
+    std::vector<size_t> buff_sizes;
+    BOOST_FOREACH(volk_type_t sig, both_sigs) {
+        buff_sizes.push_back(vlen * sig.size * (sig.is_complex ? 2 : 1));
+        buffs.push_back(mem_pool.get_new(buff_sizes.back()));
+        kernel_result.bytes_per_point += sig.size * (sig.is_complex ? 2 : 1);
+    }
+    for(size_t j = 0; j < inputsig.size(); j++) {
+        const size_t buff = outputsig.size() + j;
+        inputs.push_back(mem_pool.get_new(buff_sizes[buff]));
+        load_random_data(inputs.back(), inputsig[j], vlen, test_params.data());
+    }
+    kernel_result.working_set = std::accumulate(buff_sizes.begin(), buff_sizes.end(), (size_t)0);
+
+    // the cost of reading the clock, taken off every call
+    std::vector<double> empty(1000);
+    for(size_t i = 0; i < empty.size(); i++) {
+        const uint64_t start = volk_qa_ticks(timer);
+        empty[i] = (double)(volk_qa_ticks(timer) - start);
+    }
+    std::sort(empty.begin(), empty.end());
+    const double overhead = empty[empty.size() / 2];
+
+    // a puppet's pointer is the one of the actual function, which works in
+    // place on the inputs of the puppet
+    std::vector<volk_type_t> dispatcher_sigs = both_sigs;
+    std::vector<void *> dispatcher_buffs = buffs;
+    if(test_case.puppet_master_name() != "NULL") {
+        dispatcher_sigs = inputsig;
+        dispatcher_buffs.assign(buffs.begin() + outputsig.size(), buffs.end());
+    }
+
+    // the paths to time: the public pointer, then _manual and each impl
+    std::vector<std::string> paths;
+    if(test_case.dispatcher() != NULL) paths.push_back("dispatcher");
+    else std::cout << "No dispatcher path, cannot call " << test_case.puppet_master_name() << std::endl;
+    volk_func_desc_t desc = test_case.desc();
+    for(size_t i = 0; i < desc.n_impls; i++) {
+        paths.push_back(std::string("manual_") + desc.impl_names[i]);
+        paths.push_back(std::string("direct_") + desc.impl_names[i]);
+    }
+
+    BOOST_FOREACH(std::string path, paths) {
+        const bool manual = (path.compare(0, 7, "manual_") == 0);
+        const std::string impl = path.substr(path.find('_') + 1);
+        const char *impl_name = impl.c_str();
+        void (*impl_func)() = NULL;
+        if(path.compare(0, 7, "direct_") == 0) {
+            bool is_aligned;
+            impl_func = test_case.get_impl()(impl.c_str(), &is_aligned);
+            if(impl_func == NULL) continue;
+        }
+
+        std::vector<double> samples(iter);
+        uint64_t total = 0;
+        for(unsigned int it = 0; it < test_params.warmup() + iter; it++) {
+            for(size_t j = 0; j < inputs.size(); j++) {
+                memcpy(buffs[outputsig.size() + j], inputs[j], buff_sizes[outputsig.size() + j]);
+            }
+            // read the pointer every call, like code calling the kernel does
+            void (*func)() = (manual || impl_func)? impl_func : *test_case.dispatcher();
+
+            const uint64_t start = volk_qa_ticks(timer);
+            if(manual) run_arch_test(test_case.kernel_ptr(), both_sigs, inputsc, buffs, test_params.scalar(), vlen, 1, impl_name);
+            else if(impl_func) run_impl_call(func, both_sigs, inputsc, buffs, test_params.scalar(), vlen);
+            else run_impl_call(func, dispatcher_sigs, inputsc, dispatcher_buffs, test_params.scalar(), vlen);
+            const uint64_t end = volk_qa_ticks(timer);
+
+            if(it < test_params.warmup()) continue;
+            samples[it - test_params.warmup()] = std::max((double)(end - start) - overhead, 0.0);
+            total += end - start;
+        }
+
+        volk_test_time_t result;
+        result.name = path;
+        result.time = (units == "ns")? total / 1e6 : (double)total;
+        result.units = (units == "ns")? "ms" : "ticks";
+        result.pass = true;
+        result.stat_units = units;
+        compute_time_stats(result, samples);
+        compute_histogram(result, samples);
+        std::cout << path << ": median " << result.median << units << " [" << result.ci_low << ", "
+                  << result.ci_high << "] min " << result.min << " p99 " << result.p99 << std::endl;
+        kernel_result.results[path] = result;
+    }
+    std::cout << "timer overhead " << overhead << units << " per call was subtracted" << std::endl;
+
+    return true;
+}
@@ -25,9 +25,75 @@ struct volk_type_t {
 class volk_test_time_t {
     public:
         std::string name;
-        double time;
+        double time;         // total time of all iterations
         std::string units;
         bool pass;
+        // statistics of the single iterations, in stat_units per call
+        unsigned int samples;
+        double min;
+        double median;
+        double p99;
+        double mean;
+        double ci_low;       // 95% confidence interval of the median
+        double ci_high;
+        std::string stat_units;
+        // throughput in samples/s of each thread running the impl at once
+        std::vector<double> thread_throughput;
+        // hardware events per call, empty unless counted
+        std::map<std::string, double> counters;
+        // latency histogram, bins of histogram_width from histogram_start,
+        // the last bin counts the calls above the 99th percentile
+        double histogram_start;
+        double histogram_width;
+        std::vector<unsigned int> histogram;
+        // error of the float outputs against error_reference, in units in
+        // the last place and relative to the reference; -1 without float
+        // outputs. The reference is "double" for kernels computing a libm
+        // function, which are checked against it in double precision, and
+        // "generic" otherwise, a baseline that is not exact itself. Outputs
+        // where only one side is nan or inf are counted in
+        // nonfinite_mismatches instead.
+        std::string error_reference;
+        double max_ulp;
+        double mean_ulp;
+        double max_rel_err;
+        double mean_rel_err;
+        size_t nonfinite_mismatches;
+        // the same over a sweep of the input domain of the function, -1
+        // unless the reference is "double"
+        double domain_max_ulp;
+        double domain_mean_ulp;
+        double domain_max_rel_err;
+        size_t domain_nonfinite_mismatches;
+        volk_test_time_t() : time(0), pass(false), samples(0), min(0), median(0),
+            p99(0), mean(0), ci_low(0), ci_high(0), histogram_start(0), histogram_width(0),
+            max_ulp(-1), mean_ulp(-1), max_rel_err(-1), mean_rel_err(-1),
+            nonfinite_mismatches(0), domain_max_ulp(-1), domain_mean_ulp(-1),
+            domain_max_rel_err(-1), domain_nonfinite_mismatches(0) {};
+};
+
+// where the buffers of the timed calls reside
+enum volk_test_cache_t {
+    VOLK_CACHE_HOT,          // the same buffers every call
+    VOLK_CACHE_L2,           // rotate over buffers exceeding the L1 data cache
+    VOLK_CACHE_L3,           // rotate over buffers exceeding the L2 cache
+    VOLK_CACHE_DRAM          // rotate over buffers exceeding the last level cache
+};
+
+// the values the inputs of the kernels are filled with
+enum volk_test_data_t {
+    VOLK_DATA_UNIFORM,       // uniform in (-1, 1), or over the integer range
+    VOLK_DATA_GAUSSIAN,      // gaussian noise
+    VOLK_DATA_TONE,          // a sine wave, complex data gets a complex tone
+    VOLK_DATA_QPSK,          // random +-1/sqrt(2) symbols
+    VOLK_DATA_DENORMAL,      // subnormal floats
+    VOLK_DATA_SATURATE       // integer limits, floats beyond the 32 bit ints
+};
+
+// the clock timing each iteration
+enum volk_test_timer_t {
+    VOLK_TIMER_MONOTONIC,    // monotonic clock, ns
+    VOLK_TIMER_RDTSC         // time stamp counter of x86 cpus, ticks
 };
 
 class volk_test_results_t {
@@ -36,9 +102,19 @@ class volk_test_results_t {
         std::string config_name;
         unsigned int vlen;
         unsigned int iter;
+        double bytes_per_point;    // size of one point of all vector arguments
+        std::string cache_mode;    // hot, l2, l3 or dram
+        std::string data;          // distribution of the input data
+        size_t working_set;        // bytes of the buffers each impl rotates over
+        unsigned int threads;      // threads running each impl at once
         std::map<std::string, volk_test_time_t> results;
         std::string best_arch_a;
         std::string best_arch_u;
+        // best impls per vector length bucket, empty unless swept
+        std::vector<std::string> bucket_arch_a;
+        std::vector<std::string> bucket_arch_u;
+        volk_test_results_t() : vlen(0), iter(0), bytes_per_point(0),
+            working_set(0), threads(1) {};
 };
 
 class volk_test_params_t {
@@ -49,12 +125,49 @@ class volk_test_params_t {
         unsigned int _iter;
         bool _benchmark_mode;
         std::string _kernel_regex;
+        unsigned int _warmup;
+        volk_test_timer_t _timer;
+        volk_test_cache_t _cache;
+        unsigned int _threads;
+        bool _counters;
+        volk_test_data_t _data;
+        double _max_ulp;
+        double _max_rel_err;
     public:
         // ctor
         volk_test_params_t(float tol, lv_32fc_t scalar, unsigned int vlen, unsigned int iter,
-                           bool benchmark_mode, std::string kernel_regex) :
+                           bool benchmark_mode, std::string kernel_regex,
+                           unsigned int warmup=0, volk_test_timer_t timer=VOLK_TIMER_MONOTONIC,
+                           volk_test_cache_t cache=VOLK_CACHE_HOT, unsigned int threads=1,
+                           bool counters=false, volk_test_data_t data=VOLK_DATA_UNIFORM) :
             _tol(tol), _scalar(scalar), _vlen(vlen), _iter(iter),
-            _benchmark_mode(benchmark_mode), _kernel_regex(kernel_regex) {};
+            _benchmark_mode(benchmark_mode), _kernel_regex(kernel_regex),
+            _warmup(warmup), _timer(timer), _cache(cache), _threads(threads),
+            _counters(counters), _data(data), _max_ulp(0), _max_rel_err(0) {};
+        // copies with a different tolerance or iteration count
+        volk_test_params_t make_tol(float tol) {
+            volk_test_params_t params(*this);
+            params._tol = tol;
+            return params;
+        };
+        volk_test_params_t make_iter(unsigned int iter) {
+            volk_test_params_t params(*this);
+            params._iter = iter;
+            return params;
+        };
+        volk_test_params_t make_vlen(unsigned int vlen) {
+            volk_test_params_t params(*this);
+            params._vlen = vlen;
+            return params;
+        };
+        // float outputs pass within these errors instead of the tolerance,
+        // 0 leaves a bound out
+        volk_test_params_t make_accuracy(double max_ulp, double max_rel_err) {
+            volk_test_params_t params(*this);
+            params._max_ulp = max_ulp;
+            params._max_rel_err = max_rel_err;
+            return params;
+        };
         // getters
         float tol() {return _tol;};
         lv_32fc_t scalar() {return _scalar;};
@@ -62,8 +175,19 @@ class volk_test_params_t {
         unsigned int iter() {return _iter;};
         bool benchmark_mode() {return _benchmark_mode;};
         std::string kernel_regex() {return _kernel_regex;};
+        unsigned int warmup() {return _warmup;};
+        volk_test_timer_t timer() {return _timer;};
+        volk_test_cache_t cache() {return _cache;};
+        unsigned int threads() {return _threads;};
+        bool counters() {return _counters;};
+        volk_test_data_t data() {return _data;};
+        double max_ulp() {return _max_ulp;};
+        double max_rel_err() {return _max_rel_err;};
 };
 
+// the <kernel>_get_impl function of a kernel
+typedef void (*(*volk_fn_get_impl)(const char *, bool *))();
+
 class volk_test_case_t {
     private:
         volk_func_desc_t _desc;
@@ -71,23 +195,31 @@ class volk_test_case_t {
         std::string _name;
         volk_test_params_t _test_parameters;
         std::string _puppet_master_name;
+        void(**_dispatcher)();
+        volk_fn_get_impl _get_impl;
     public:
         volk_func_desc_t desc() {return _desc;};
         void (*kernel_ptr()) () {return _kernel_ptr;};
         std::string name() {return _name;};
         std::string puppet_master_name() {return _puppet_master_name;};
         volk_test_params_t test_parameters() {return _test_parameters;};
+        // the public function pointer of the kernel, for puppets the one of
+        // the actual function or NULL when the harness cannot call it
+        void (**dispatcher()) () {return _dispatcher;};
+        volk_fn_get_impl get_impl() {return _get_impl;};
         // normal ctor
         volk_test_case_t(volk_func_desc_t desc, void(*kernel_ptr)(), std::string name,
-            volk_test_params_t test_parameters) :
+            volk_test_params_t test_parameters,
+            void(**dispatcher)() = NULL, volk_fn_get_impl get_impl = NULL) :
             _desc(desc), _kernel_ptr(kernel_ptr), _name(name), _test_parameters(test_parameters),
-            _puppet_master_name("NULL")
+            _puppet_master_name("NULL"), _dispatcher(dispatcher), _get_impl(get_impl)
             {};
         // ctor for puppets
         volk_test_case_t(volk_func_desc_t desc, void(*kernel_ptr)(), std::string name,
-            std::string puppet_master_name, volk_test_params_t test_parameters) :
+            std::string puppet_master_name, volk_test_params_t test_parameters,
+            void(**dispatcher)() = NULL, volk_fn_get_impl get_impl = NULL) :
             _desc(desc), _kernel_ptr(kernel_ptr), _name(name), _test_parameters(test_parameters),
-            _puppet_master_name(puppet_master_name)
+            _puppet_master_name(puppet_master_name), _dispatcher(dispatcher), _get_impl(get_impl)
             {};
 };
 
@@ -96,16 +228,28 @@ class volk_test_case_t {
  ************************************************/
 volk_type_t volk_type_from_string(std::string);
 
+volk_test_cache_t volk_test_cache_from_string(std::string);
+volk_test_data_t volk_test_data_from_string(std::string);
+std::string volk_test_data_to_string(volk_test_data_t);
+void load_random_data(void *data, volk_type_t type, unsigned int n,
+                      volk_test_data_t dist = VOLK_DATA_UNIFORM);
+std::string volk_test_cache_to_string(volk_test_cache_t);
+size_t volk_cache_size(unsigned int level);
+std::vector<int> physical_cores();
+
 float uniform(void);
 void random_floats(float *buf, unsigned n);
 
+// with get_impl each impl is resolved once and called directly in the
+// timed region, without the name lookup of the manual call
 bool run_volk_tests(
     volk_func_desc_t,
     void(*)(),
     std::string,
     volk_test_params_t,
     std::vector<volk_test_results_t> *results = NULL,
-    std::string puppet_master_name = "NULL"
+    std::string puppet_master_name = "NULL",
+    volk_fn_get_impl get_impl = NULL
     );
 
 bool run_volk_tests(
@@ -122,6 +266,8 @@ bool run_volk_tests(
 );
 
 
+bool run_volk_latency(volk_test_case_t test_case, std::vector<volk_test_results_t> *results);
+
 #define VOLK_RUN_TESTS(func, tol, scalar, len, iter) \
     BOOST_AUTO_TEST_CASE(func##_test) { \
         BOOST_CHECK_EQUAL(run_volk_tests( \
@@ -129,8 +275,8 @@ bool run_volk_tests(
             std::string(#func), tol, scalar, len, iter, 0, "NULL"), \
           0); \
     }
-#define VOLK_PROFILE(func, test_params, results) run_volk_tests(func##_get_func_desc(), (void (*)())func##_manual, std::string(#func), test_params, results, "NULL")
-#define VOLK_PUPPET_PROFILE(func, puppet_master_func, test_params, results) run_volk_tests(func##_get_func_desc(), (void (*)())func##_manual, std::string(#func), test_params, results, std::string(#puppet_master_func))
+#define VOLK_PROFILE(func, test_params, results) run_volk_tests(func##_get_func_desc(), (void (*)())func##_manual, std::string(#func), test_params, results, "NULL", (volk_fn_get_impl)func##_get_impl)
+#define VOLK_PUPPET_PROFILE(func, puppet_master_func, test_params, results) run_volk_tests(func##_get_func_desc(), (void (*)())func##_manual, std::string(#func), test_params, results, std::string(#puppet_master_func), (volk_fn_get_impl)func##_get_impl)
 typedef void (*volk_fn_1arg)(void *, unsigned int, const char*); //one input, operate in place
 typedef void (*volk_fn_2arg)(void *, void *, unsigned int, const char*);
 typedef void (*volk_fn_3arg)(void *, void *, void *, unsigned int, const char*);
@@ -141,5 +287,16 @@ typedef void (*volk_fn_3arg_s32f)(void *, void *, void *, float, unsigned int, c
 typedef void (*volk_fn_1arg_s32fc)(void *, lv_32fc_t, unsigned int, const char*); //one input vector, one scalar float input
 typedef void (*volk_fn_2arg_s32fc)(void *, void *, lv_32fc_t, unsigned int, const char*);
 typedef void (*volk_fn_3arg_s32fc)(void *, void *, void *, lv_32fc_t, unsigned int, const char*);
+// the same without the impl name, for the dispatcher and the impls
+typedef void (*volk_impl_1arg)(void *, unsigned int);
+typedef void (*volk_impl_2arg)(void *, void *, unsigned int);
+typedef void (*volk_impl_3arg)(void *, void *, void *, unsigned int);
+typedef void (*volk_impl_4arg)(void *, void *, void *, void *, unsigned int);
+typedef void (*volk_impl_1arg_s32f)(void *, float, unsigned int);
+typedef void (*volk_impl_2arg_s32f)(void *, void *, float, unsigned int);
+typedef void (*volk_impl_3arg_s32f)(void *, void *, void *, float, unsigned int);
+typedef void (*volk_impl_1arg_s32fc)(void *, lv_32fc_t, unsigned int);
+typedef void (*volk_impl_2arg_s32fc)(void *, void *, lv_32fc_t, unsigned int);
+typedef void (*volk_impl_3arg_s32fc)(void *, void *, void *, lv_32fc_t, unsigned int);
 
 #endif //VOLK_QA_UTILS_H
@@ -24,14 +24,749 @@
 #include "kernel_tests.h"
 
 #include <volk/volk.h>
+#include <volk/volk_prefs.h>
+#include <volk/volk_cpu.h>
 
 #include <vector>
 #include <utility>
 #include <iostream>
 #include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#else
+#include <pthread.h>
+#include <sys/stat.h>
+#endif
 
 void print_qa_xml(std::vector<volk_test_results_t> results, unsigned int nfails);
 
+/*
+ * Tests of the library around the kernels. Like run_volk_tests they
+ * return true on failure, QA_CHECK reports every failed condition.
+ */
+#define QA_CHECK(cond) do { if(!(cond)) { \
+        std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #cond << std::endl; \
+        failed = true; } } while(0)
+
+typedef bool (*volk_lib_test_t)(void);
+
+static void fill_pref(volk_arch_pref_t *pref, const char *name, const char *impl)
+{
+    memset(pref, 0, sizeof(*pref));
+    strncpy(pref->name, name, sizeof(pref->name) - 1);
+    strncpy(pref->impl_a, impl, sizeof(pref->impl_a) - 1);
+    strncpy(pref->impl_u, impl, sizeof(pref->impl_u) - 1);
+}
+
+static void qa_mkdir(const std::string &path)
+{
+#if defined(_WIN32)
+    _mkdir(path.c_str());
+#else
+    mkdir(path.c_str(), 0755);
+#endif
+}
+
+//set an environment variable, NULL removes it
+static void qa_setenv(const char *name, const char *value)
+{
+#if defined(_WIN32)
+    _putenv_s(name, value? value : "");
+#else
+    if(value) setenv(name, value, 1);
+    else unsetenv(name);
+#endif
+}
+
+//point VOLK_CONFIGPATH at dir while a test runs
+class qa_config_dir
+{
+public:
+    qa_config_dir(const std::string &dir) : _dir(dir)
+    {
+        const char *old = getenv("VOLK_CONFIGPATH");
+        _had_old = (old != NULL);
+        if(_had_old) _old = old;
+        qa_mkdir(_dir);
+        qa_mkdir(_dir + "/volk");
+        qa_setenv("VOLK_CONFIGPATH", _dir.c_str());
+    }
+
+    ~qa_config_dir()
+    {
+        qa_setenv("VOLK_CONFIGPATH", _had_old? _old.c_str() : NULL);
+    }
+
+    //path of a file in the volk directory that the library searches
+    std::string file(const std::string &name) const
+    {
+        return _dir + "/volk/" + name;
+    }
+
+    void write(const std::string &name, const std::string &contents) const
+    {
+        std::ofstream config(file(name).c_str());
+        config << contents;
+    }
+
+private:
+    std::string _dir;
+    std::string _old;
+    bool _had_old;
+};
+
+static bool qa_binary_config_round_trip(void)
+{
+    bool failed = false;
+    const char *path = ".unittest/volk_config_qa";
+    char cpu_model[64];
+    volk_arch_pref_t mine[2], other[1];
+    volk_arch_pref_t *loaded = NULL;
+    size_t n_loaded;
+
+    volk_get_cpu_model(cpu_model, sizeof(cpu_model));
+    fill_pref(&mine[0], "volk_32f_x2_add_32f", "generic");
+    fill_pref(&mine[1], "volk_32f_sin_32f", "generic");
+    strncpy(mine[1].bucket_impl_a[VOLK_VLEN_BUCKET_SMALL], "generic", 127);
+    fill_pref(&other[0], "volk_32f_x2_add_32f", "neon");
+
+    remove(path);
+    QA_CHECK(volk_write_binary_preferences(path, "qa_other_machine", "", other, 1) == 0);
+    QA_CHECK(volk_write_binary_preferences(path, volk_get_machine(), cpu_model, mine, 2) == 0);
+    //rewriting the section of this machine keeps the other one
+    QA_CHECK(volk_write_binary_preferences(path, volk_get_machine(), cpu_model, mine, 2) == 0);
+
+    n_loaded = volk_load_preferences_file(path, &loaded);
+    QA_CHECK(n_loaded == 2);
+    if(n_loaded == 2) {
+        QA_CHECK(memcmp(loaded, mine, sizeof(mine)) == 0);
+    }
+    volk_free_preferences(loaded);
+
+    //a record without its terminating \0 makes the file invalid,
+    //so writing replaces it instead of keeping its sections
+    std::FILE *config_file = std::fopen(path, "r+b");
+    QA_CHECK(config_file != NULL);
+    if(config_file != NULL) {
+        volk_config_header_t header;
+        char junk[sizeof(mine[0].name)];
+        memset(junk, 'x', sizeof(junk));
+        QA_CHECK(std::fread(&header, sizeof(header), 1, config_file) == 1);
+        std::fseek(config_file, sizeof(header) + header.n_sections * sizeof(volk_config_section_t), SEEK_SET);
+        std::fwrite(junk, sizeof(junk), 1, config_file);
+        std::fclose(config_file);
+    }
+    QA_CHECK(volk_write_binary_preferences(path, "qa_other_machine", "", other, 1) == 0);
+    config_file = std::fopen(path, "rb");
+    if(config_file != NULL) {
+        volk_config_header_t header;
+        QA_CHECK(std::fread(&header, sizeof(header), 1, config_file) == 1);
+        QA_CHECK(header.n_sections == 1);
+        std::fclose(config_file);
+    }
+
+    remove(path);
+    return failed;
+}
+
+static bool qa_default_prefs(void)
+{
+    bool failed = false;
+    static const volk_default_pref_t stepping_4[] = {
+        {"volk_32f_x2_add_32f", "generic", "generic", {"generic", "generic", "generic", "generic"}},
+        {"volk_32f_x2_multiply_32f", "no_such_impl", "generic", {"generic", "generic", "generic", "generic"}},
+        {NULL, NULL, NULL, {NULL, NULL, NULL, NULL}}
+    };
+    static const volk_default_pref_t stepping_7[] = {
+        {"volk_32f_x2_add_32f", "a_qa", "u_qa", {"generic", "generic", "a_qa", "u_qa"}},
+        {NULL, NULL, NULL, {NULL, NULL, NULL, NULL}}
+    };
+    //the other stepping is listed first, the exact model still wins
+    static const volk_default_profile_t profiles[] = {
+        {"QaVendor-6-85-7", stepping_7},
+        {"QaVendor-6-85-4", stepping_4},
+        {NULL, NULL}
+    };
+    const volk_func_desc_t desc = volk_32f_x2_add_32f_get_func_desc();
+    volk_arch_pref_t *prefs = NULL;
+
+    QA_CHECK(volk_load_default_preferences(profiles, "QaVendor-6-85-4", &prefs) == 2);
+    if(prefs != NULL) {
+        QA_CHECK(std::string(prefs[0].name) == "volk_32f_x2_add_32f");
+        QA_CHECK(std::string(prefs[1].impl_a) == "no_such_impl");
+        //every impl exists for the first, the second names an unknown one
+        QA_CHECK(volk_pref_usable(&prefs[0], desc.impl_names, desc.n_impls));
+        QA_CHECK(!volk_pref_usable(&prefs[1], desc.impl_names, desc.n_impls));
+    }
+    volk_free_preferences(prefs);
+
+    //any other stepping of the model, with the buckets in their slots
+    prefs = NULL;
+    QA_CHECK(volk_load_default_preferences(profiles, "QaVendor-6-85-9", &prefs) == 1);
+    if(prefs != NULL) {
+        QA_CHECK(std::string(prefs[0].bucket_impl_a[VOLK_VLEN_BUCKET_SMALL]) == "generic");
+        QA_CHECK(std::string(prefs[0].bucket_impl_u[VOLK_VLEN_BUCKET_MEDIUM]) == "u_qa");
+        QA_CHECK(std::string(prefs[0].bucket_impl_a[VOLK_VLEN_BUCKET_LARGE]) == "a_qa");
+        QA_CHECK(!volk_pref_usable(&prefs[0], desc.impl_names, desc.n_impls));
+    }
+    volk_free_preferences(prefs);
+
+    //another model or vendor has no profile
+    prefs = NULL;
+    QA_CHECK(volk_load_default_preferences(profiles, "QaVendor-6-86-4", &prefs) == 0);
+    QA_CHECK(volk_load_default_preferences(profiles, "QaVendor-6-8", &prefs) == 0);
+    QA_CHECK(volk_load_default_preferences(profiles, "", &prefs) == 0);
+    QA_CHECK(prefs == NULL);
+    return failed;
+}
+
+static bool qa_config_search(void)
+{
+    bool failed = false;
+    char cpu_model[64], path[512];
+#if defined(_WIN32)
+    const std::string sep = ";";
+#else
+    const std::string sep = ":";
+#endif
+
+    volk_get_cpu_model(cpu_model, sizeof(cpu_model));
+    const std::string model(cpu_model);
+    const std::string family = model.substr(0, model.rfind('-'));
+
+    qa_config_dir second(".unittest/qa_search_second");
+    qa_config_dir first(".unittest/qa_search_first");
+    //empty entries are skipped, earlier directories win over later ones
+    qa_setenv("VOLK_CONFIGPATH", (sep + ".unittest/qa_search_first" + sep + sep +
+        ".unittest/qa_search_second").c_str());
+
+    second.write("volk_config_" + model, "");
+    volk_find_config_path(path);
+    QA_CHECK(second.file("volk_config_" + model) == path);
+
+    //within a directory the cpu model beats the model without the
+    //stepping, which beats the plain volk_config
+    first.write("volk_config", "");
+    volk_find_config_path(path);
+    QA_CHECK(first.file("volk_config") == path);
+    first.write("volk_config_" + family, "");
+    volk_find_config_path(path);
+    QA_CHECK(first.file("volk_config_" + family) == path);
+    first.write("volk_config_" + model, "");
+    volk_find_config_path(path);
+    QA_CHECK(first.file("volk_config_" + model) == path);
+
+    //volk_profile writes to the first directory
+    volk_get_config_path(path);
+    QA_CHECK(std::string(".unittest/qa_search_first/volk/volk_config") == path);
+
+    remove(first.file("volk_config_" + model).c_str());
+    remove(first.file("volk_config_" + family).c_str());
+    remove(first.file("volk_config").c_str());
+    volk_find_config_path(path);
+    QA_CHECK(second.file("volk_config_" + model) == path);
+
+    //without any, the search goes on outside VOLK_CONFIGPATH
+    remove(second.file("volk_config_" + model).c_str());
+    volk_find_config_path(path);
+    QA_CHECK(std::string(path).find(".unittest/qa_search") == std::string::npos);
+    return failed;
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI qa_init_thread(LPVOID kernel)
+{
+    volk_init();
+    *(p_32f_x2_add_32f *)kernel = volk_32f_x2_add_32f;
+    return 0;
+}
+#else
+static void *qa_init_thread(void *kernel)
+{
+    volk_init();
+    *(p_32f_x2_add_32f *)kernel = volk_32f_x2_add_32f;
+    return NULL;
+}
+#endif
+
+static bool qa_init_once(void)
+{
+    bool failed = false;
+    p_32f_x2_add_32f seen[4];
+
+    //racing threads all see the kernels resolved
+#if defined(_WIN32)
+    HANDLE threads[4];
+    for(unsigned int i = 0; i < 4; i++) {
+        seen[i] = NULL;
+        threads[i] = CreateThread(NULL, 0, &qa_init_thread, &seen[i], 0, NULL);
+        QA_CHECK(threads[i] != NULL);
+    }
+    for(unsigned int i = 0; i < 4; i++) {
+        if(threads[i] == NULL) continue;
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+    }
+#else
+    pthread_t threads[4];
+    bool started[4];
+    for(unsigned int i = 0; i < 4; i++) {
+        seen[i] = NULL;
+        started[i] = (pthread_create(&threads[i], NULL, &qa_init_thread, &seen[i]) == 0);
+        QA_CHECK(started[i]);
+    }
+    for(unsigned int i = 0; i < 4; i++) {
+        if(started[i]) pthread_join(threads[i], NULL);
+    }
+#endif
+    for(unsigned int i = 0; i < 4; i++) {
+        QA_CHECK(seen[i] != NULL && seen[i] == seen[0]);
+    }
+
+    //later calls do not resolve them again, so a binding survives
+    const p_32f_x2_add_32f generic = volk_32f_x2_add_32f_set_impl("generic");
+    volk_init();
+    QA_CHECK(volk_32f_x2_add_32f == generic);
+    volk_32f_x2_add_32f_set_impl(NULL);
+    return failed;
+}
+
+static bool qa_set_impl(void)
+{
+    bool failed = false;
+    const volk_func_desc_t desc = volk_32f_x2_add_32f_get_func_desc();
+    const p_32f_x2_add_32f preferred = volk_32f_x2_add_32f_set_impl(NULL);
+    const p_32f_x2_add_32f preferred_u = volk_32f_x2_add_32f_u;
+    std::vector<float> a(1000, 1.0f), b(1000, 2.0f), c(1000, 0.0f);
+    bool is_aligned = true;
+
+    //unknown names leave the kernel alone
+    QA_CHECK(volk_32f_x2_add_32f_get_impl("no_such_impl", NULL) == NULL);
+    QA_CHECK(volk_32f_x2_add_32f_set_impl("no_such_impl") == NULL);
+    QA_CHECK(volk_32f_x2_add_32f == preferred);
+
+    const p_32f_x2_add_32f generic = volk_32f_x2_add_32f_get_impl("generic", &is_aligned);
+    QA_CHECK(generic != NULL);
+    QA_CHECK(!is_aligned);
+    QA_CHECK(volk_32f_x2_add_32f_set_impl("generic") == generic);
+    QA_CHECK(volk_32f_x2_add_32f == generic);
+    QA_CHECK(volk_32f_x2_add_32f_a == generic);
+    QA_CHECK(volk_32f_x2_add_32f_u == generic);
+    volk_32f_x2_add_32f(&c[0], &a[0], &b[0], c.size());
+    QA_CHECK(c[0] == 3.0f && c[c.size() - 1] == 3.0f);
+
+    //NULL goes back to the preferred impls
+    QA_CHECK(volk_32f_x2_add_32f_set_impl(NULL) == preferred);
+    QA_CHECK(volk_32f_x2_add_32f == preferred);
+    QA_CHECK(volk_32f_x2_add_32f_u == preferred_u);
+
+    //an aligned impl keeps the unaligned path
+    for(size_t i = 0; i < desc.n_impls; i++) {
+        if(!desc.impl_alignment[i]) continue;
+        const p_32f_x2_add_32f impl = volk_32f_x2_add_32f_set_impl(desc.impl_names[i]);
+        QA_CHECK(impl != NULL);
+        QA_CHECK(volk_32f_x2_add_32f_a == impl);
+        QA_CHECK(volk_32f_x2_add_32f_u == preferred_u);
+        QA_CHECK(volk_32f_x2_add_32f != impl);
+        volk_32f_x2_add_32f_set_impl(NULL);
+    }
+    return failed;
+}
+
+static bool qa_bucket_dispatch(void)
+{
+    bool failed = false;
+    const volk_func_desc_t desc = volk_32f_x2_add_32f_get_func_desc();
+    std::vector<std::string> impls_a, impls_u;
+    std::vector<float> a(5001, 1.0f), b(5001, 2.0f), c(5001, 0.0f);
+
+    //a different impl per bucket where the machine has enough of them
+    for(size_t i = 0; i < desc.n_impls; i++) {
+        impls_a.push_back(desc.impl_names[i]);
+        if(!desc.impl_alignment[i]) impls_u.push_back(desc.impl_names[i]);
+    }
+    const std::string small_a = impls_a[0], medium_a = impls_a[1 % impls_a.size()], large_a = impls_a[2 % impls_a.size()];
+    const std::string small_u = impls_u[0], medium_u = impls_u[1 % impls_u.size()], large_u = impls_u[2 % impls_u.size()];
+
+    {
+        qa_config_dir config(".unittest/qa_buckets");
+        config.write("volk_config", "volk_32f_x2_add_32f " + large_a + " " + large_u + " " +
+            small_a + " " + small_u + " " + medium_a + " " + medium_u + "\n");
+        volk_reload_preferences();
+
+        const unsigned int vlens[] = {1, 63, 64, 4095, 4096, 5000};
+        for(size_t v = 0; v < sizeof(vlens) / sizeof(vlens[0]); v++) {
+            const size_t bucket = volk_vlen_bucket(vlens[v]);
+            const std::string &impl_a = (bucket == VOLK_VLEN_BUCKET_SMALL)? small_a :
+                (bucket == VOLK_VLEN_BUCKET_MEDIUM)? medium_a : large_a;
+            const std::string &impl_u = (bucket == VOLK_VLEN_BUCKET_SMALL)? small_u :
+                (bucket == VOLK_VLEN_BUCKET_MEDIUM)? medium_u : large_u;
+            QA_CHECK(volk_32f_x2_add_32f_get_dispatch_impl(vlens[v], true) ==
+                volk_32f_x2_add_32f_get_impl(impl_a.c_str(), NULL));
+            QA_CHECK(volk_32f_x2_add_32f_get_dispatch_impl(vlens[v], false) ==
+                volk_32f_x2_add_32f_get_impl(impl_u.c_str(), NULL));
+
+            c.assign(c.size(), 0.0f);
+            volk_32f_x2_add_32f(&c[1], &a[1], &b[1], vlens[v] - 1);
+            volk_32f_x2_add_32f(&c[0], &a[0], &b[0], vlens[v]);
+            QA_CHECK(c[0] == 3.0f && c[vlens[v] - 1] == 3.0f && c[vlens[v]] == 0.0f);
+        }
+        QA_CHECK(VOLK_VLEN_SMALL_MAX == 64 && VOLK_VLEN_MEDIUM_MAX == 4096);
+
+        //a single impl pair for all lengths does not check the length at all
+        config.write("volk_config", "volk_32f_x2_add_32f " + large_a + " " + large_u + "\n");
+        volk_reload_preferences();
+        QA_CHECK(volk_32f_x2_add_32f_get_dispatch_impl(1, false) ==
+            volk_32f_x2_add_32f_get_impl(large_u.c_str(), NULL));
+        QA_CHECK(volk_32f_x2_add_32f_u == volk_32f_x2_add_32f_get_impl(large_u.c_str(), NULL));
+        remove(config.file("volk_config").c_str());
+    }
+    volk_reload_preferences();
+    return failed;
+}
+
+//the saved pref of a kernel in the autotune file, false when it has none
+static bool qa_find_tuned(const std::string &path, const char *name, volk_arch_pref_t *pref)
+{
+    volk_arch_pref_t *prefs = NULL;
+    const size_t n_prefs = volk_load_preferences_file(path.c_str(), &prefs);
+    bool found = false;
+    for(size_t i = 0; i < n_prefs && !found; i++) {
+        if(strcmp(prefs[i].name, name)) continue;
+        *pref = prefs[i];
+        found = true;
+    }
+    volk_free_preferences(prefs);
+    return found;
+}
+
+static bool qa_autotune(void)
+{
+    bool failed = false;
+    const volk_func_desc_t desc = volk_32f_x2_add_32f_get_func_desc();
+    const unsigned int n = 1000, calls = 2;
+    float *a = (float *) volk_malloc((n + 1) * sizeof(float), volk_get_alignment());
+    float *b = (float *) volk_malloc((n + 1) * sizeof(float), volk_get_alignment());
+    float *c = (float *) volk_malloc((n + 1) * sizeof(float), volk_get_alignment());
+    const p_32f_x2_multiply_32f generic = volk_32f_x2_multiply_32f_get_impl("generic", NULL);
+    volk_arch_pref_t pref;
+    size_t n_unaligned = 0;
+
+    QA_CHECK(a && b && c);
+    if(!(a && b && c)) return failed;
+    for(unsigned int i = 0; i <= n; i++) {
+        a[i] = 1.0f;
+        b[i] = 2.0f;
+    }
+    for(size_t i = 0; i < desc.n_impls; i++) n_unaligned += !desc.impl_alignment[i];
+
+    {
+        //a config for another kernel, so that the tested ones are unprofiled
+        qa_config_dir config(".unittest/qa_autotune");
+        const std::string tuned = config.file("volk_autotune");
+        config.write("volk_config", "volk_32f_x2_subtract_32f generic generic\n");
+        remove(tuned.c_str());
+        qa_setenv("VOLK_AUTOTUNE", "2");
+        volk_reload_preferences();
+
+        //every candidate is timed twice per path, results stay right
+        for(size_t i = 0; i < calls * desc.n_impls; i++) {
+            c[0] = 0.0f;
+            volk_32f_x2_add_32f(c, a, b, n);
+            QA_CHECK(c[0] == 3.0f && c[n - 1] == 3.0f);
+        }
+        for(size_t i = 0; i < calls * n_unaligned; i++) {
+            c[1] = 0.0f;
+            volk_32f_x2_add_32f(c + 1, a + 1, b + 1, n);
+            QA_CHECK(c[1] == 3.0f && c[n] == 3.0f);
+        }
+        const p_32f_x2_add_32f winner_a = volk_32f_x2_add_32f_a;
+        const p_32f_x2_add_32f winner_u = volk_32f_x2_add_32f_u;
+        QA_CHECK(volk_32f_x2_add_32f_get_dispatch_impl(n, true) == winner_a);
+        QA_CHECK(volk_32f_x2_add_32f_get_dispatch_impl(n, false) == winner_u);
+        volk_32f_x2_add_32f(c, a, b, n);
+        QA_CHECK(volk_32f_x2_add_32f_a == winner_a);
+
+        //set_impl ends tuning, later calls cannot rebind the kernel
+        volk_32f_x2_multiply_32f(c, a, b, n);
+        QA_CHECK(volk_32f_x2_multiply_32f_set_impl("generic") == generic);
+        for(size_t i = 0; i < calls * desc.n_impls; i++) {
+            volk_32f_x2_multiply_32f(c, a, b, n);
+            volk_32f_x2_multiply_32f(c + 1, a + 1, b + 1, n);
+        }
+        QA_CHECK(volk_32f_x2_multiply_32f == generic);
+        QA_CHECK(volk_32f_x2_multiply_32f_a == generic);
+        QA_CHECK(volk_32f_x2_multiply_32f_u == generic);
+
+        //only measured winners are saved
+        volk_autotune_flush();
+        QA_CHECK(qa_find_tuned(tuned, "volk_32f_x2_add_32f", &pref));
+        QA_CHECK(volk_32f_x2_add_32f_get_impl(pref.impl_a, NULL) == winner_a);
+        QA_CHECK(volk_32f_x2_add_32f_get_impl(pref.impl_u, NULL) == winner_u);
+        QA_CHECK(!qa_find_tuned(tuned, "volk_32f_x2_multiply_32f", &pref));
+
+        //the next run starts out with the saved winners
+        volk_reload_preferences();
+        QA_CHECK(volk_32f_x2_add_32f_a == winner_a);
+        QA_CHECK(volk_32f_x2_add_32f_u == winner_u);
+
+        qa_setenv("VOLK_AUTOTUNE", NULL);
+        remove(tuned.c_str());
+        remove(config.file("volk_config").c_str());
+    }
+    volk_reload_preferences();
+    volk_free(a);
+    volk_free(b);
+    volk_free(c);
+    return failed;
+}
+
+static bool qa_arena(void)
+{
+    bool failed = false;
+    volk_arena_t *arena = volk_arena_create(1024);
+    QA_CHECK(arena != NULL);
+    if(arena == NULL) return failed;
+
+    char *first = (char *) volk_arena_alloc(arena, 100);
+    char *second = (char *) volk_arena_alloc(arena, 100);
+    QA_CHECK(first != NULL && second != NULL);
+    QA_CHECK(volk_is_aligned(first) && volk_is_aligned(second));
+    QA_CHECK(second >= first + 100);
+    QA_CHECK(volk_arena_used(arena) == (size_t)(second - first) * 2);
+
+    //a full arena refuses, a reset hands out the same memory again
+    QA_CHECK(volk_arena_alloc(arena, 1024) == NULL);
+    QA_CHECK(volk_arena_alloc(arena, (size_t)-1) == NULL);
+    volk_arena_reset(arena);
+    QA_CHECK(volk_arena_used(arena) == 0);
+    QA_CHECK(volk_arena_alloc(arena, 1024) == first);
+    QA_CHECK(volk_arena_alloc(arena, 1) == NULL);
+    volk_arena_destroy(arena);
+    return failed;
+}
+
+#if !defined(_WIN32)
+static void *qa_pool_thread(void *)
+{
+    //keeps buffers on the free lists of a thread that never trims
+    void *buffers[4];
+    for(unsigned int i = 0; i < 4; i++) buffers[i] = volk_pool_alloc(64 << i);
+    for(unsigned int i = 0; i < 4; i++) volk_pool_free(buffers[i]);
+    return NULL;
+}
+#endif
+
+static bool qa_pool(void)
+{
+    bool failed = false;
+
+    //a freed buffer is handed out again for the same size class
+    void *first = volk_pool_alloc(100);
+    QA_CHECK(first != NULL && volk_is_aligned(first));
+    volk_pool_free(first);
+    void *again = volk_pool_alloc(120);
+    QA_CHECK(again == first);
+    void *other = volk_pool_alloc(1000);
+    QA_CHECK(other != NULL && other != first && volk_is_aligned(other));
+
+    //buffers above the largest size class bypass the free lists
+    void *large = volk_pool_alloc(VOLK_POOL_MAX_SIZE + 1);
+    QA_CHECK(large != NULL && volk_is_aligned(large));
+    memset(large, 0, VOLK_POOL_MAX_SIZE + 1);
+    volk_pool_free(large);
+    volk_pool_free(other);
+    volk_pool_free(again);
+    volk_pool_free(NULL);
+    volk_pool_trim();
+
+#if !defined(_WIN32)
+    //a thread exiting with kept buffers is trimmed by the pool itself
+    pthread_t thread;
+    QA_CHECK(pthread_create(&thread, NULL, &qa_pool_thread, NULL) == 0);
+    pthread_join(thread, NULL);
+#endif
+    return failed;
+}
+
+static bool qa_malloc_huge(void)
+{
+    bool failed = false;
+    const size_t size = 3 * 1024 * 1024 + 100;
+    volk_malloc_placement_t placement;
+
+    //no huge pages asked for, the regular page size
+    char *plain = (char *) volk_malloc_huge(1000, 0, -1);
+    QA_CHECK(plain != NULL && volk_is_aligned(plain));
+    if(plain == NULL) return failed;
+    volk_malloc_placement(plain, &placement);
+    const size_t page_size = placement.page_size;
+    QA_CHECK(page_size > 0 && ((uintptr_t)plain % page_size) == 0);
+    QA_CHECK(placement.huge_bytes == 0);
+    volk_free_huge(plain);
+
+    //explicit huge pages fall back to regular ones when none are
+    //reserved, and the placement reports what was granted
+    char *huge = (char *) volk_malloc_huge(size, VOLK_MALLOC_HUGE_EXPLICIT | VOLK_MALLOC_PREFAULT, 0);
+    QA_CHECK(huge != NULL && volk_is_aligned(huge));
+    if(huge == NULL) return failed;
+    memset(huge, 1, size);
+    QA_CHECK(huge[0] == 1 && huge[size - 1] == 1);
+    volk_malloc_placement(huge, &placement);
+    QA_CHECK(placement.page_size >= page_size);
+    QA_CHECK(placement.huge_bytes <= size);
+    if(placement.page_size > page_size) {
+        QA_CHECK(placement.huge_bytes == size);
+    }
+    volk_free_huge(huge);
+
+    //a node that does not exist is ignored
+    char *far = (char *) volk_malloc_huge(1000, VOLK_MALLOC_HUGE_TRANSPARENT, 100000);
+    QA_CHECK(far != NULL);
+    volk_free_huge(far);
+
+    QA_CHECK(volk_malloc_huge((size_t)-1, VOLK_MALLOC_HUGE_TRANSPARENT, -1) == NULL);
+    volk_free_huge(NULL);
+    return failed;
+}
+
+static bool qa_malloc_ring(void)
+{
+    bool failed = false;
+    const size_t size = volk_ring_size(5000);
+    QA_CHECK(size >= 5000 && (size & (size - 1)) == 0);
+    QA_CHECK(volk_ring_size(size) == size);
+    QA_CHECK(volk_ring_size(1) <= size && (volk_ring_size(1) & (volk_ring_size(1) - 1)) == 0);
+
+    float *ring = (float *) volk_malloc_ring(size);
+#if defined(__linux__)
+    QA_CHECK(ring != NULL);
+#endif
+    if(ring == NULL) return failed;
+    const size_t n = size / sizeof(float);
+    QA_CHECK(volk_is_aligned(ring));
+
+    //the second mapping mirrors the first, both ways
+    for(size_t i = 0; i < n; i++) ring[i] = (float)i;
+    QA_CHECK(ring[n] == 0.0f && ring[2 * n - 1] == (float)(n - 1));
+    ring[n + 3] = -1.0f;
+    QA_CHECK(ring[3] == -1.0f);
+    ring[3] = 3.0f;
+
+    //a kernel writing across the end of the ring wraps to its start
+    const size_t start = n - 10, len = 100;
+    volk_32f_x2_add_32f(ring + start, ring + start, ring + start, len);
+    size_t wrong = 0;
+    for(size_t i = 0; i < len; i++) {
+        const size_t pos = (start + i) % n;
+        wrong += (ring[pos] != 2.0f * (float)pos);
+    }
+    QA_CHECK(wrong == 0);
+
+    QA_CHECK(volk_malloc_ring(size + 1) == NULL);
+    volk_free_ring(ring);
+    volk_free_ring(NULL);
+    return failed;
+}
+
+static bool qa_close(float a, float b)
+{
+    return std::fabs(a - b) <= 1e-5f * std::max(1.0f, std::fabs(b));
+}
+
+static bool qa_peel(void)
+{
+    bool failed = false;
+    const unsigned int max_points = 1100;
+    const unsigned int vlens[] = {63, 64, 65, 1000};
+    //offsets in points of the output and of the inputs, the last pair
+    //never aligns together
+    const unsigned int offsets[][2] = {{0, 0}, {1, 1}, {2, 2}, {3, 3}, {5, 5}, {7, 7}, {1, 2}};
+    float *a = (float *) volk_malloc(max_points * sizeof(float), volk_get_alignment());
+    float *b = (float *) volk_malloc(max_points * sizeof(float), volk_get_alignment());
+    float *out = (float *) volk_malloc(max_points * sizeof(float), volk_get_alignment());
+    float *ref = (float *) volk_malloc(max_points * sizeof(float), volk_get_alignment());
+    lv_32fc_t *ca = (lv_32fc_t *) volk_malloc(max_points * sizeof(lv_32fc_t), volk_get_alignment());
+    lv_32fc_t *cb = (lv_32fc_t *) volk_malloc(max_points * sizeof(lv_32fc_t), volk_get_alignment());
+    lv_32fc_t *cout = (lv_32fc_t *) volk_malloc(max_points * sizeof(lv_32fc_t), volk_get_alignment());
+    lv_32fc_t *cref = (lv_32fc_t *) volk_malloc(max_points * sizeof(lv_32fc_t), volk_get_alignment());
+    int16_t *s = (int16_t *) volk_malloc(max_points * sizeof(int16_t), volk_get_alignment());
+    QA_CHECK(a && b && out && ref && ca && cb && cout && cref && s);
+    if(!(a && b && out && ref && ca && cb && cout && cref && s)) return failed;
+
+    for(unsigned int i = 0; i < max_points; i++) {
+        a[i] = 0.25f * i - 100.0f;
+        b[i] = 1.0f / (i + 1);
+        ca[i] = lv_cmake(a[i], b[i]);
+        cb[i] = lv_cmake(b[i], -a[i]);
+        s[i] = (int16_t)(37 * i - 20000);
+    }
+
+    //the public kernels peel misaligned heads, the results must not change
+    for(unsigned int v = 0; v < sizeof(vlens) / sizeof(vlens[0]); v++) {
+        const unsigned int n = vlens[v];
+        for(unsigned int o = 0; o < sizeof(offsets) / sizeof(offsets[0]); o++) {
+            const unsigned int out_off = offsets[o][0], in_off = offsets[o][1];
+            unsigned int wrong = 0;
+
+            volk_32f_x2_add_32f_manual(ref, a + in_off, b + in_off, n, "generic");
+            volk_32f_x2_add_32f(out + out_off, a + in_off, b + in_off, n);
+            for(unsigned int i = 0; i < n; i++) wrong += !qa_close(out[out_off + i], ref[i]);
+
+            volk_32fc_x2_multiply_32fc_manual(cref, ca + in_off, cb + in_off, n, "generic");
+            volk_32fc_x2_multiply_32fc(cout + out_off, ca + in_off, cb + in_off, n);
+            for(unsigned int i = 0; i < n; i++) {
+                wrong += !qa_close(lv_creal(cout[out_off + i]), lv_creal(cref[i]));
+                wrong += !qa_close(lv_cimag(cout[out_off + i]), lv_cimag(cref[i]));
+            }
+
+            //points of different sizes, the output and input align apart
+            volk_16i_s32f_convert_32f_manual(ref, s + in_off, 32768.0f, n, "generic");
+            volk_16i_s32f_convert_32f(out + out_off, s + in_off, 32768.0f, n);
+            for(unsigned int i = 0; i < n; i++) wrong += !qa_close(out[out_off + i], ref[i]);
+
+            if(wrong) {
+                std::cerr << "peel: " << wrong << " wrong points at vlen " << n << ", offsets "
+                          << out_off << "/" << in_off << std::endl;
+                failed = true;
+            }
+        }
+    }
+
+    volk_free(a);
+    volk_free(b);
+    volk_free(out);
+    volk_free(ref);
+    volk_free(ca);
+    volk_free(cb);
+    volk_free(cout);
+    volk_free(cref);
+    volk_free(s);
+    return failed;
+}
+
+static const std::pair<std::string, volk_lib_test_t> lib_tests[] = {
+    std::make_pair(std::string("binary_config_round_trip"), &qa_binary_config_round_trip),
+    std::make_pair(std::string("default_prefs"), &qa_default_prefs),
+    std::make_pair(std::string("config_search"), &qa_config_search),
+    std::make_pair(std::string("init_once"), &qa_init_once),
+    std::make_pair(std::string("set_impl"), &qa_set_impl),
+    std::make_pair(std::string("bucket_dispatch"), &qa_bucket_dispatch),
+    std::make_pair(std::string("autotune"), &qa_autotune),
+    std::make_pair(std::string("arena"), &qa_arena),
+    std::make_pair(std::string("pool"), &qa_pool),
+    std::make_pair(std::string("malloc_huge"), &qa_malloc_huge),
+    std::make_pair(std::string("malloc_ring"), &qa_malloc_ring),
+    std::make_pair(std::string("peel"), &qa_peel),
+};
+
 int main()
 {
     bool qa_ret_val = 0;
@@ -55,7 +790,8 @@ int main()
         volk_test_case_t test_case = test_cases[ii];
         try {
             qa_result = run_volk_tests(test_case.desc(), test_case.kernel_ptr(), test_case.name(),
-                test_case.test_parameters(), &results, test_case.puppet_master_name());
+                test_case.test_parameters(), &results, test_case.puppet_master_name(),
+                test_case.get_impl());
         }
         catch(...) {
             // TODO: what exceptions might we need to catch and how do we handle them?
@@ -69,12 +805,30 @@ int main()
         }
     }
 
+    // Test the library around the kernels
+    volk_test_results_t lib_results;
+    lib_results.name = "library";
+    const size_t n_lib_tests = sizeof(lib_tests) / sizeof(lib_tests[0]);
+    for(unsigned int ii = 0; ii < n_lib_tests; ++ii) {
+        volk_test_time_t result;
+        result.name = lib_tests[ii].first;
+        result.time = 0;
+        result.units = "ms";
+        result.pass = !lib_tests[ii].second();
+        lib_results.results[result.name] = result;
+        if(!result.pass) {
+            std::cerr << "Failure on " << result.name << std::endl;
+            qa_failures.push_back(result.name);
+        }
+    }
+    results.push_back(lib_results);
+
     // Generate XML results
     print_qa_xml(results, qa_failures.size());
 
     // Summarize QA results
     std::cerr << "Kernel QA finished: " << qa_failures.size() << " failures out of "
-        << test_cases.size() << " tests." << std::endl;
+        << test_cases.size() + n_lib_tests << " tests." << std::endl;
     if(qa_failures.size() > 0) {
         std::cerr << "The following kernels failed QA:" << std::endl;
         for(unsigned int ii = 0; ii < qa_failures.size(); ++ii) {
@@ -0,0 +1,66 @@
+/* -*- c -*- */
+/*
+ * Copyright 2016 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Built by testqa_static.cmake against the volk/volk_static.h of the
+ * machine this host runs, checks the static kernels against generic.
+ */
+
+#include <volk/volk_static.h>
+#include <stdio.h>
+
+int main(void)
+{
+    const unsigned int num_points = 1000;
+    const size_t size = (num_points + 1) * sizeof(float);
+    float *a = (float *) volk_malloc(size, volk_get_alignment());
+    float *b = (float *) volk_malloc(size, volk_get_alignment());
+    float *c = (float *) volk_malloc(size, volk_get_alignment());
+    float *ref = (float *) volk_malloc(size, volk_get_alignment());
+    unsigned int i, offset, errors = 0;
+
+    if(!a || !b || !c || !ref) return 1;
+    for(i = 0; i <= num_points; i++) {
+        a[i] = (float)i * 0.5f;
+        b[i] = 3.0f - (float)i;
+    }
+
+    //the dispatching name and the unaligned impl take any buffers,
+    //the aligned impl only gets the aligned ones
+    for(offset = 0; offset < 2; offset++) {
+        volk_32f_x2_add_32f_generic(ref, a + offset, b + offset, num_points);
+        volk_32f_x2_add_32f(c + offset, a + offset, b + offset, num_points);
+        for(i = 0; i < num_points; i++) errors += (c[i + offset] != ref[i]);
+        volk_32f_x2_add_32f_u(c + offset, a + offset, b + offset, num_points);
+        for(i = 0; i < num_points; i++) errors += (c[i + offset] != ref[i]);
+        if(offset != 0) continue;
+        volk_32f_x2_add_32f_a(c, a, b, num_points);
+        for(i = 0; i < num_points; i++) errors += (c[i] != ref[i]);
+    }
+
+    printf("volk_static.h for %s: %u errors\n", VOLK_STATIC_MACHINE, errors);
+    volk_free(a);
+    volk_free(b);
+    volk_free(c);
+    volk_free(ref);
+    return errors != 0;
+}
@@ -0,0 +1,70 @@
+# Copyright 2016 Free Software Foundation, Inc.
+#
+# This file is part of Volk
+#
+# Volk is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3, or (at your option)
+# any later version.
+#
+# Volk is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+# or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+# License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with Volk; see the file COPYING.  If not, write to the Free
+# Software Foundation, Inc., 51 Franklin Street, Boston, MA
+# 02110-1301, USA.
+
+########################################################################
+# Run with cmake -P by the qa_static_header test: generate
+# volk/volk_static.h for the machine this host runs, build
+# testqa_static.c against it and run the program.
+# The variables below are passed in with -D:
+#
+# PYTHON_EXECUTABLE - runs the generator
+# SOURCE_DIR        - top of the VOLK sources
+# INCLUDE_DIR       - the generated headers of the build
+# BINARY_DIR        - scratch directory of the test
+# C_COMPILER        - the compiler VOLK was built with
+# MACHINE_FLAGS     - file setting <machine>_flags for every machine
+# CONFIG_INFO       - volk-config-info, to ask for the machine
+# LIBRARY           - the volk library to link
+########################################################################
+include(${MACHINE_FLAGS})
+
+execute_process(COMMAND ${CONFIG_INFO} --machine
+    OUTPUT_VARIABLE machine OUTPUT_STRIP_TRAILING_WHITESPACE
+    RESULT_VARIABLE result)
+if(result OR NOT DEFINED ${machine}_flags)
+    message(FATAL_ERROR "Could not determine the machine of this host: ${machine}")
+endif()
+message(STATUS "Static dispatch for ${machine}")
+
+file(MAKE_DIRECTORY ${BINARY_DIR}/include/volk)
+execute_process(COMMAND ${PYTHON_EXECUTABLE}
+    ${SOURCE_DIR}/gen/volk_tmpl_utils.py
+    --input ${SOURCE_DIR}/tmpl/volk_static.tmpl.h
+    --output ${BINARY_DIR}/include/volk/volk_static.h ${machine}
+    RESULT_VARIABLE result)
+if(result)
+    message(FATAL_ERROR "Generating volk/volk_static.h failed")
+endif()
+
+get_filename_component(library_dir ${LIBRARY} PATH)
+separate_arguments(flags UNIX_COMMAND "${${machine}_flags}")
+execute_process(COMMAND ${C_COMPILER} ${flags} -Wall
+    -I${BINARY_DIR}/include -I${INCLUDE_DIR}
+    -I${SOURCE_DIR}/include -I${SOURCE_DIR}/kernels
+    ${SOURCE_DIR}/lib/testqa_static.c -o ${BINARY_DIR}/testqa_static
+    ${LIBRARY} -Wl,-rpath,${library_dir} -lm
+    RESULT_VARIABLE result)
+if(result)
+    message(FATAL_ERROR "Building against volk/volk_static.h failed")
+endif()
+
+execute_process(COMMAND ${BINARY_DIR}/testqa_static RESULT_VARIABLE result)
+if(result)
+    message(FATAL_ERROR "The kernels of volk/volk_static.h are wrong")
+endif()
@@ -0,0 +1,231 @@
+/* -*- c -*- */
+/*
+ * Copyright 2016 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <volk/volk.h>
+#include <volk/volk_arena.h>
+#include <volk/volk_malloc.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#if defined(_MSC_VER)
+#define VOLK_THREAD_LOCAL __declspec(thread)
+#else
+#define VOLK_THREAD_LOCAL __thread
+#endif
+
+//the smallest pool size class is 1 << VOLK_POOL_MIN_SHIFT bytes
+#define VOLK_POOL_MIN_SHIFT 6
+#define VOLK_POOL_N_CLASSES 15
+//freed buffers kept per size class and thread
+#define VOLK_POOL_KEEP 8
+//size class of the buffers that bypass the free lists
+#define VOLK_POOL_LARGE VOLK_POOL_N_CLASSES
+
+struct volk_arena
+{
+    char *base;         //the memory handed out
+    size_t size;        //bytes in base
+    size_t offset;      //first free byte
+    size_t alignment;   //of every buffer
+};
+
+//alignment of the buffers, room for the pool header in front of them
+static size_t volk_arena_alignment(void)
+{
+    size_t alignment = volk_get_alignment();
+    return (alignment < 2*sizeof(void *))? 2*sizeof(void *) : alignment;
+}
+
+volk_arena_t *volk_arena_create(size_t size)
+{
+    volk_arena_t *arena = (volk_arena_t *) malloc(sizeof(*arena));
+    if(arena == NULL) return NULL;
+    arena->alignment = volk_arena_alignment();
+    arena->size = size;
+    arena->offset = 0;
+    arena->base = (char *) volk_malloc(size? size : 1, arena->alignment);
+    if(arena->base == NULL) {
+        free(arena);
+        return NULL;
+    }
+    return arena;
+}
+
+void *volk_arena_alloc(volk_arena_t *arena, size_t size)
+{
+    void *ptr;
+    //round up so that the next buffer is aligned as well
+    const size_t padded = (size + arena->alignment - 1) & ~(arena->alignment - 1);
+    if(padded < size || padded > arena->size - arena->offset) return NULL;
+    ptr = arena->base + arena->offset;
+    arena->offset += padded;
+    return ptr;
+}
+
+void volk_arena_reset(volk_arena_t *arena)
+{
+    arena->offset = 0;
+}
+
+size_t volk_arena_used(const volk_arena_t *arena)
+{
+    return arena->offset;
+}
+
+void volk_arena_destroy(volk_arena_t *arena)
+{
+    if(arena == NULL) return;
+    volk_free(arena->base);
+    free(arena);
+}
+
+//free lists of the calling thread, linked through the first word of
+//each buffer
+static VOLK_THREAD_LOCAL void *volk_pool_free_list[VOLK_POOL_N_CLASSES];
+static VOLK_THREAD_LOCAL unsigned int volk_pool_kept[VOLK_POOL_N_CLASSES];
+static VOLK_THREAD_LOCAL int volk_pool_watched;
+
+//threads that keep buffers are trimmed when they exit, see
+//volk_pool_watch_thread
+#if defined(_WIN32)
+static DWORD volk_pool_fls = FLS_OUT_OF_INDEXES;
+static INIT_ONCE volk_pool_fls_once = INIT_ONCE_STATIC_INIT;
+
+static VOID WINAPI volk_pool_thread_exit(PVOID data)
+{
+    if(data != NULL) volk_pool_trim();
+}
+
+static BOOL CALLBACK volk_pool_fls_init(PINIT_ONCE once, PVOID param, PVOID *context)
+{
+    volk_pool_fls = FlsAlloc(&volk_pool_thread_exit);
+    return TRUE;
+}
+
+static void volk_pool_watch_thread(void)
+{
+    InitOnceExecuteOnce(&volk_pool_fls_once, volk_pool_fls_init, NULL, NULL);
+    if(volk_pool_fls != FLS_OUT_OF_INDEXES) FlsSetValue(volk_pool_fls, (PVOID)1);
+    volk_pool_watched = 1;
+}
+#else
+static pthread_key_t volk_pool_key;
+static pthread_once_t volk_pool_key_once = PTHREAD_ONCE_INIT;
+static int volk_pool_key_valid = 0;
+
+static void volk_pool_thread_exit(void *data)
+{
+    if(data != NULL) volk_pool_trim();
+}
+
+static void volk_pool_key_init(void)
+{
+    volk_pool_key_valid = (pthread_key_create(&volk_pool_key, &volk_pool_thread_exit) == 0);
+}
+
+static void volk_pool_watch_thread(void)
+{
+    pthread_once(&volk_pool_key_once, &volk_pool_key_init);
+    if(volk_pool_key_valid) pthread_setspecific(volk_pool_key, &volk_pool_key);
+    volk_pool_watched = 1;
+}
+
+#if defined(__GNUC__)
+//threads that outlive an unloaded library must not call into it
+__attribute__((destructor)) static void volk_pool_key_fini(void)
+{
+    if(volk_pool_key_valid) pthread_key_delete(volk_pool_key);
+}
+#endif
+#endif
+
+//the size class is stored right in front of the buffer
+static size_t *volk_pool_header(void *ptr)
+{
+    return (size_t *)ptr - 1;
+}
+
+static size_t volk_pool_class(size_t size)
+{
+    size_t size_class = 0;
+    while(size_class < VOLK_POOL_LARGE &&
+          ((size_t)1 << (size_class + VOLK_POOL_MIN_SHIFT)) < size) size_class++;
+    return size_class;
+}
+
+void *volk_pool_alloc(size_t size)
+{
+    const size_t size_class = volk_pool_class(size);
+    size_t alignment;
+    char *base;
+    void *ptr;
+
+    if(size_class < VOLK_POOL_LARGE && volk_pool_free_list[size_class] != NULL) {
+        ptr = volk_pool_free_list[size_class];
+        volk_pool_free_list[size_class] = *(void **)ptr;
+        volk_pool_kept[size_class]--;
+        return ptr;
+    }
+
+    alignment = volk_arena_alignment();
+    if(size_class < VOLK_POOL_LARGE) size = (size_t)1 << (size_class + VOLK_POOL_MIN_SHIFT);
+    if(size > (size_t)-1 - alignment) return NULL;
+    base = (char *) volk_malloc(alignment + size, alignment);
+    if(base == NULL) return NULL;
+    ptr = base + alignment;
+    *volk_pool_header(ptr) = size_class;
+    return ptr;
+}
+
+void volk_pool_free(void *ptr)
+{
+    size_t size_class;
+    if(ptr == NULL) return;
+    size_class = *volk_pool_header(ptr);
+    if(size_class < VOLK_POOL_LARGE && volk_pool_kept[size_class] < VOLK_POOL_KEEP) {
+        if(!volk_pool_watched) volk_pool_watch_thread();
+        *(void **)ptr = volk_pool_free_list[size_class];
+        volk_pool_free_list[size_class] = ptr;
+        volk_pool_kept[size_class]++;
+        return;
+    }
+    volk_free((char *)ptr - volk_arena_alignment());
+}
+
+void volk_pool_trim(void)
+{
+    const size_t alignment = volk_arena_alignment();
+    size_t size_class;
+    for(size_class = 0; size_class < VOLK_POOL_N_CLASSES; size_class++) {
+        while(volk_pool_free_list[size_class] != NULL) {
+            void *ptr = volk_pool_free_list[size_class];
+            volk_pool_free_list[size_class] = *(void **)ptr;
+            volk_free((char *)ptr - alignment);
+        }
+        volk_pool_kept[size_class] = 0;
+    }
+}
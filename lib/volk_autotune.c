@@ -0,0 +1,296 @@
+/*
+ * Copyright 2016 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <volk_autotune.h>
+#include <volk/volk.h>
+#include <volk/volk_cpu.h>
+#include <volk/volk_prefs.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <direct.h>
+#define mkdir(path, mode) _mkdir(path)
+#endif
+
+//the number of timed calls per candidate when VOLK_AUTOTUNE is not a number
+#define VOLK_AUTOTUNE_DEFAULT_CALLS 16
+
+static volk_autotune_t *volk_autotune_list = NULL;
+
+unsigned int volk_autotune_calls(void)
+{
+    const char *env = getenv("VOLK_AUTOTUNE");
+    int calls;
+    if(env == NULL || getenv("VOLK_GENERIC")) return 0;
+    calls = atoi(env);
+    if(calls > 0) return calls;
+    return (env[0] == '0')? 0 : VOLK_AUTOTUNE_DEFAULT_CALLS;
+}
+
+uint64_t volk_autotune_ticks(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER count;
+    QueryPerformanceCounter(&count);
+    return count.QuadPart;
+#elif defined(HAVE_CLOCK_GETTIME)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000 + ts.tv_nsec;
+#else
+    return clock();
+#endif
+}
+
+static bool volk_autotune_try_lock(volk_autotune_t *tune)
+{
+#if defined(_MSC_VER)
+    return InterlockedExchange((volatile LONG *)&tune->busy, 1) == 0;
+#else
+    return __sync_lock_test_and_set(&tune->busy, 1) == 0;
+#endif
+}
+
+static void volk_autotune_unlock(volk_autotune_t *tune)
+{
+#if defined(_MSC_VER)
+    InterlockedExchange((volatile LONG *)&tune->busy, 0);
+#else
+    __sync_lock_release(&tune->busy);
+#endif
+}
+
+//a path with a single candidate is done without being measured,
+//a stopped one is done without a winner
+static bool volk_autotune_measured(const volk_autotune_slot_t *slot)
+{
+    return slot->done && slot->calls > 0;
+}
+
+bool volk_autotune_tuned(const volk_autotune_t *tune, bool aligned)
+{
+    return volk_autotune_measured(&tune->slot[aligned]);
+}
+
+void volk_autotune_release(volk_autotune_t *tune)
+{
+    volk_autotune_unlock(tune);
+}
+
+void volk_autotune_stop(volk_autotune_t *tune)
+{
+    size_t i;
+    //wait for a timed call to bind its winner
+    while(!volk_autotune_try_lock(tune));
+    for(i = 0; i < 2; i++) {
+        if(tune->slot[i].done) continue;
+        tune->slot[i].done = true;
+        tune->slot[i].calls = 0;
+    }
+    volk_autotune_unlock(tune);
+}
+
+//the tuned kernels go next to the per-user volk_config, in a file of
+//their own so that they never shadow a config written by hand or by
+//volk_profile; volk_autotune_load_preferences reads it back
+static void volk_autotune_path(char *path)
+{
+    char *name;
+    volk_get_config_path(path);
+    if(!path[0]) return;
+    name = strrchr(path, '/');
+    name = (name != NULL)? name + 1 : path;
+    snprintf(name, 512 - (name - path), "volk_autotune");
+}
+
+size_t volk_autotune_load_preferences(volk_arch_pref_t **prefs_res)
+{
+    char path[512];
+    volk_autotune_path(path);
+    if(!path[0]) return 0;
+    return volk_load_preferences_file(path, prefs_res);
+}
+
+//add the tuned kernels that the autotune file does not list yet
+void volk_autotune_flush(void)
+{
+    char path[512], cpu_model[64], *slash;
+    volk_arch_pref_t *old_prefs = NULL, *prefs;
+    volk_autotune_t *tune;
+    size_t n_old, n_prefs = 0, n_tuned = 0, i, bucket;
+
+    for(tune = volk_autotune_list; tune != NULL; tune = tune->next) {
+        if(tune->saved) continue;
+        if(volk_autotune_measured(&tune->slot[0]) || volk_autotune_measured(&tune->slot[1])) n_tuned++;
+    }
+    if(n_tuned == 0) return;
+
+    volk_autotune_path(path);
+    if(!path[0]) return;
+    n_old = volk_load_preferences_file(path, &old_prefs);
+
+    prefs = (volk_arch_pref_t *) calloc(n_old + n_tuned, sizeof(*prefs));
+    if(prefs == NULL) {
+        volk_free_preferences(old_prefs);
+        return;
+    }
+    if(n_old) memcpy(prefs, old_prefs, n_old * sizeof(*prefs));
+    volk_free_preferences(old_prefs);
+    n_prefs = n_old;
+    for(tune = volk_autotune_list; tune != NULL; tune = tune->next) {
+        volk_arch_pref_t *p = prefs + n_prefs;
+        if(tune->saved) continue;
+        if(!volk_autotune_measured(&tune->slot[0]) && !volk_autotune_measured(&tune->slot[1])) continue;
+        for(i = 0; i < n_old; i++) {
+            if(!strcmp(prefs[i].name, tune->name)) break;
+        }
+        if(i < n_old) continue;
+        strncpy(p->name, tune->name, sizeof(p->name)-1);
+        strncpy(p->impl_a, tune->impl_names[tune->slot[true].winner], sizeof(p->impl_a)-1);
+        strncpy(p->impl_u, tune->impl_names[tune->slot[false].winner], sizeof(p->impl_u)-1);
+        for(bucket = 0; bucket < VOLK_N_VLEN_BUCKETS; bucket++) {
+            strcpy(p->bucket_impl_a[bucket], p->impl_a);
+            strcpy(p->bucket_impl_u[bucket], p->impl_u);
+        }
+        n_prefs++;
+    }
+
+    //the config directory may not exist yet
+    slash = strrchr(path, '/');
+    if(slash != NULL) {
+        *slash = '\0';
+        mkdir(path, 0755);
+        *slash = '/';
+    }
+
+    volk_get_cpu_model(cpu_model, sizeof(cpu_model));
+    if(n_prefs > n_old && volk_write_binary_preferences(path, volk_get_machine(),
+        cpu_model, prefs, n_prefs) != 0) {
+        fprintf(stderr, "Volk warning: could not save the tuned kernels to %s\n", path);
+    }
+    else {
+        //the file lists them now, later flushes skip them
+        for(tune = volk_autotune_list; tune != NULL; tune = tune->next) {
+            if(volk_autotune_measured(&tune->slot[0]) || volk_autotune_measured(&tune->slot[1])) tune->saved = true;
+        }
+    }
+    free(prefs);
+}
+
+#if defined(__GNUC__)
+//runs at exit and when the library is unloaded early, unlike atexit
+//handlers, which would call into a library that is no longer mapped
+__attribute__((destructor)) static void volk_autotune_fini(void)
+{
+    volk_autotune_flush();
+}
+#endif
+
+static bool volk_autotune_init_slot(volk_autotune_slot_t *slot,
+    const bool* alignment, size_t n_impls, bool aligned, size_t ranked)
+{
+    size_t i;
+    slot->winner = ranked;
+    slot->candidates = (size_t *) calloc(n_impls, sizeof(*slot->candidates));
+    slot->best = (double *) calloc(n_impls, sizeof(*slot->best));
+    if(slot->candidates == NULL || slot->best == NULL) return false;
+
+    //any impl can run on aligned buffers, unaligned ones need unaligned impls
+    for(i = 0; i < n_impls; i++) {
+        if(aligned || !alignment[i]) slot->candidates[slot->n_candidates++] = i;
+    }
+    slot->done = (slot->n_candidates < 2);
+    return !slot->done;
+}
+
+bool volk_autotune_init(
+    volk_autotune_t *tune,
+    const char *name,
+    const char *impl_names[],
+    const bool* alignment,
+    size_t n_impls,
+    size_t index_a,
+    size_t index_u
+)
+{
+    bool tune_a, tune_u;
+
+    //keep the results when a kernel is initialized again
+    if(tune->name != NULL) return !tune->slot[0].done || !tune->slot[1].done;
+
+    tune->name = name;
+    tune->impl_names = impl_names;
+    tune->n_calls = volk_autotune_calls();
+    tune_u = volk_autotune_init_slot(&tune->slot[false], alignment, n_impls, false, index_u);
+    tune_a = volk_autotune_init_slot(&tune->slot[true], alignment, n_impls, true, index_a);
+
+    tune->next = volk_autotune_list;
+    volk_autotune_list = tune;
+    return tune_a || tune_u;
+}
+
+int volk_autotune_begin(volk_autotune_t *tune, bool aligned)
+{
+    volk_autotune_slot_t *slot = &tune->slot[aligned];
+    if(slot->done) return -1;
+
+    //only one call at a time is timed, the others use the bound impl
+    if(!volk_autotune_try_lock(tune)) return -1;
+    if(slot->done) {
+        volk_autotune_unlock(tune);
+        return -1;
+    }
+    return slot->candidates[slot->calls % slot->n_candidates];
+}
+
+int volk_autotune_end(volk_autotune_t *tune, bool aligned,
+    uint64_t ticks, unsigned int num_points)
+{
+    volk_autotune_slot_t *slot = &tune->slot[aligned];
+    const size_t candidate = slot->calls % slot->n_candidates;
+    const double per_point = (double)ticks / (num_points? num_points : 1);
+    int winner = -1;
+    size_t i;
+
+    //keep the fastest call of each candidate, it is the least disturbed one
+    if(slot->calls < slot->n_candidates || per_point < slot->best[candidate]) {
+        slot->best[candidate] = per_point;
+    }
+    slot->calls++;
+
+    if(slot->calls == slot->n_candidates * tune->n_calls) {
+        size_t best = 0;
+        for(i = 1; i < slot->n_candidates; i++) {
+            if(slot->best[i] < slot->best[best]) best = i;
+        }
+        slot->winner = slot->candidates[best];
+        slot->done = true;
+        winner = slot->winner;
+    }
+    return winner;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2016 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDED_VOLK_AUTOTUNE_H
+#define INCLUDED_VOLK_AUTOTUNE_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <volk/volk_prefs.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//the candidates of one dispatch path, aligned or unaligned
+typedef struct volk_autotune_slot
+{
+    size_t n_candidates;  //number of impls to time
+    size_t *candidates;   //impl indexes to time
+    double *best;         //fastest time per point of each candidate
+    unsigned int calls;   //timed calls so far
+    size_t winner;        //impl index bound to this path
+    bool done;            //the winner was measured
+} volk_autotune_slot_t;
+
+//self tuning state of one kernel
+typedef struct volk_autotune
+{
+    const char *name;           //name of the kernel
+    const char **impl_names;    //list of implementations by name
+    unsigned int n_calls;       //timed calls per candidate
+    volatile int busy;          //held while a call is timed and its winner bound
+    bool saved;                 //the winners are in the autotune file
+    volk_autotune_slot_t slot[2]; //indexed by alignment
+    struct volk_autotune *next; //list of all tuned kernels
+} volk_autotune_t;
+
+//timed calls per candidate from VOLK_AUTOTUNE, 0 when tuning is off
+unsigned int volk_autotune_calls(void);
+
+//start tuning a kernel, returns false when there is nothing to tune
+bool volk_autotune_init(
+    volk_autotune_t *tune,    //state of this kernel
+    const char *name,         //name of the kernel
+    const char *impl_names[], //list of implementations by name
+    const bool* alignment,    //alignment status of each implementation
+    size_t n_impls,           //number of implementations available
+    size_t index_a,           //ranked aligned implementation
+    size_t index_u            //ranked unaligned implementation
+);
+
+//load the winners saved by earlier runs, only used for the kernels
+//that no volk_config lists
+size_t volk_autotune_load_preferences(volk_arch_pref_t **prefs);
+
+//monotonic time stamp for timing a call
+uint64_t volk_autotune_ticks(void);
+
+//the impl index to time for this call, or -1 to call the bound impl;
+//on success the caller holds the kernel until volk_autotune_release
+int volk_autotune_begin(volk_autotune_t *tune, bool aligned);
+
+//record a timed call, returns the winner when the path is done or -1
+int volk_autotune_end(volk_autotune_t *tune, bool aligned,
+    uint64_t ticks, unsigned int num_points);
+
+//let the next call be timed, after the winner of volk_autotune_end is bound
+void volk_autotune_release(volk_autotune_t *tune);
+
+//true when the path was tuned by timing its candidates
+bool volk_autotune_tuned(const volk_autotune_t *tune, bool aligned);
+
+//stop tuning a kernel whose impl was chosen otherwise; once it returns no
+//winner of a timed call is bound any more
+void volk_autotune_stop(volk_autotune_t *tune);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /*INCLUDED_VOLK_AUTOTUNE_H*/
@@ -127,3 +127,298 @@ volk_free(void *ptr)
 #endif // _POSIX_C_SOURCE >= 200112L || _XOPEN_SOURCE >= 600 || HAVE_POSIX_MEMALIGN
 
 //#endif // _ISOC11_SOURCE
+
+/*
+ * Large buffers with huge pages and numa placement. The page in front
+ * of each buffer ends with a volk_huge_header.
+ */
+
+struct volk_huge_header
+{
+  void *base;        // start of the mapping or of the volk_malloc block
+  size_t length;     // bytes mapped, 0 when allocated by volk_malloc
+  size_t size;       // bytes requested
+  size_t page_size;  // of the pages backing the buffer
+};
+
+static struct volk_huge_header *volk_huge_header(void *ptr)
+{
+  return (struct volk_huge_header *)ptr - 1;
+}
+
+#if defined(HAVE_MMAP)
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <errno.h>
+#if defined(HAVE_SYS_MBIND)
+#include <sys/syscall.h>
+#endif
+
+// from linux/mempolicy.h, which is not installed everywhere
+#define VOLK_MPOL_BIND 2
+#define VOLK_MPOL_MF_MOVE (1 << 1)
+#define VOLK_MPOL_F_NODE (1 << 0)
+#define VOLK_MPOL_F_ADDR (1 << 1)
+
+static size_t volk_huge_page_size(void)
+{
+  size_t kb = 0;
+  char line[128];
+  FILE *meminfo = fopen("/proc/meminfo", "r");
+  if(meminfo != NULL) {
+    while(fgets(line, sizeof(line), meminfo) != NULL) {
+      if(sscanf(line, "Hugepagesize: %zu kB", &kb) == 1) break;
+    }
+    fclose(meminfo);
+  }
+  return kb ? kb * 1024 : 2 * 1024 * 1024;
+}
+
+// bytes of [start, start + size) that transparent huge pages back now
+static size_t volk_anon_huge_bytes(const char *start, size_t size)
+{
+  size_t total = 0, kb;
+  unsigned long low, high;
+  int inside = 0;
+  char line[256];
+  FILE *smaps = fopen("/proc/self/smaps", "r");
+  if(smaps == NULL) return 0;
+  while(fgets(line, sizeof(line), smaps) != NULL) {
+    if(sscanf(line, "%lx-%lx ", &low, &high) == 2) {
+      inside = (low < (uintptr_t)start + size && high > (uintptr_t)start);
+    }
+    else if(inside && sscanf(line, "AnonHugePages: %zu kB", &kb) == 1) {
+      total += kb * 1024;
+    }
+  }
+  fclose(smaps);
+  return total < size ? total : size;
+}
+
+void *volk_malloc_huge(size_t size, int flags, int numa_node)
+{
+  const size_t page = (size_t) sysconf(_SC_PAGESIZE);
+  const size_t huge = volk_huge_page_size();
+  const int want_huge = flags & (VOLK_MALLOC_HUGE_TRANSPARENT | VOLK_MALLOC_HUGE_EXPLICIT);
+  const size_t align = want_huge ? huge : page;
+  size_t length = 0, page_size = page;
+  char *base = (char *) MAP_FAILED, *user = NULL, *p;
+  struct volk_huge_header *header;
+
+  if(size > (size_t)-1 - 2 * align) return NULL;
+
+#if defined(HAVE_MAP_HUGETLB)
+  if(flags & VOLK_MALLOC_HUGE_EXPLICIT) {
+    // the header takes a whole huge page
+    length = ((size + huge - 1) / huge + 1) * huge;
+    base = (char *) mmap(NULL, length, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if(base != MAP_FAILED) {
+      user = base + huge;
+      page_size = huge;
+    }
+  }
+#endif
+
+  if(base == MAP_FAILED) {
+    // room to align the buffer behind the header page
+    length = align + (size + page - 1) / page * page;
+    base = (char *) mmap(NULL, length, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(base == MAP_FAILED) {
+      fprintf(stderr, "VOLK: Error allocating memory (mmap: %s)\n", strerror(errno));
+      return NULL;
+    }
+    user = (char *)(((uintptr_t)base + page + align - 1) & ~(uintptr_t)(align - 1));
+#if defined(HAVE_MADV_HUGEPAGE)
+    if(want_huge) madvise(user, base + length - user, MADV_HUGEPAGE);
+#endif
+  }
+
+#if defined(HAVE_SYS_MBIND)
+  if(numa_node >= 0) {
+    unsigned long mask[16] = {0};
+    const size_t bits = 8 * sizeof(unsigned long);
+    if((size_t)numa_node < sizeof(mask) * 8) {
+      mask[numa_node / bits] = 1UL << (numa_node % bits);
+      if(syscall(SYS_mbind, user, base + length - user, VOLK_MPOL_BIND,
+                 mask, sizeof(mask) * 8 + 1, VOLK_MPOL_MF_MOVE) != 0) {
+        fprintf(stderr, "VOLK: could not bind memory to numa node %d (%s)\n",
+                numa_node, strerror(errno));
+      }
+    }
+  }
+#endif
+
+  header = volk_huge_header(user);
+  header->base = base;
+  header->length = length;
+  header->size = size;
+  header->page_size = page_size;
+
+  // the first touch places the pages
+  if(flags & VOLK_MALLOC_PREFAULT) {
+    for(p = user; p < user + size; p += page_size) *(volatile char *)p = 0;
+  }
+  return user;
+}
+
+void volk_malloc_placement(void *ptr, volk_malloc_placement_t *placement)
+{
+  const struct volk_huge_header *header = volk_huge_header(ptr);
+  placement->page_size = header->page_size;
+  placement->numa_node = -1;
+  if(header->length == 0) placement->huge_bytes = 0;
+  else if(header->page_size > (size_t) sysconf(_SC_PAGESIZE)) placement->huge_bytes = header->size;
+  else placement->huge_bytes = volk_anon_huge_bytes((const char *)ptr, header->size);
+#if defined(HAVE_SYS_MBIND) && defined(SYS_get_mempolicy)
+  {
+    int node;
+    if(syscall(SYS_get_mempolicy, &node, NULL, 0, ptr, VOLK_MPOL_F_NODE | VOLK_MPOL_F_ADDR) == 0) {
+      placement->numa_node = node;
+    }
+  }
+#endif
+}
+
+#else // HAVE_MMAP
+
+// without mmap the buffer comes from volk_malloc with regular pages
+void *volk_malloc_huge(size_t size, int flags, int numa_node)
+{
+  const size_t page = 4096;
+  char *base, *user;
+  struct volk_huge_header *header;
+  (void)flags;
+  (void)numa_node;
+
+  if(size > (size_t)-1 - page) return NULL;
+  base = (char *) volk_malloc(page + size, page);
+  if(base == NULL) return NULL;
+  user = base + page;
+  header = volk_huge_header(user);
+  header->base = base;
+  header->length = 0;
+  header->size = size;
+  header->page_size = page;
+  return user;
+}
+
+void volk_malloc_placement(void *ptr, volk_malloc_placement_t *placement)
+{
+  placement->page_size = volk_huge_header(ptr)->page_size;
+  placement->huge_bytes = 0;
+  placement->numa_node = -1;
+}
+
+#endif // HAVE_MMAP
+
+void volk_free_huge(void *ptr)
+{
+  struct volk_huge_header *header;
+  if(ptr == NULL) return;
+  header = volk_huge_header(ptr);
+#if defined(HAVE_MMAP)
+  if(header->length != 0) {
+    munmap(header->base, header->length);
+    return;
+  }
+#endif
+  volk_free(header->base);
+}
+
+/*
+ * Ring buffers mapped twice in a row. A private page in front of the
+ * two mappings holds a volk_ring_header.
+ */
+
+struct volk_ring_header
+{
+  void *base;     // start of the header page
+  size_t length;  // bytes mapped from base
+};
+
+static size_t volk_page_size(void)
+{
+#if defined(HAVE_MMAP)
+  return (size_t) sysconf(_SC_PAGESIZE);
+#else
+  return 4096;
+#endif
+}
+
+size_t volk_ring_size(size_t size)
+{
+  size_t ring = volk_page_size();
+  while(ring < size && ring <= ((size_t)-1 >> 2)) ring <<= 1;
+  return ring;
+}
+
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MEMFD_CREATE)
+
+#include <sys/syscall.h>
+
+void *volk_malloc_ring(size_t size)
+{
+  const size_t page = volk_page_size();
+  char *base, *ring;
+  struct volk_ring_header *header;
+  int fd;
+
+  if(size < page || (size & (size - 1)) != 0 || size > ((size_t)-1 >> 2)) {
+    fprintf(stderr, "VOLK: ring size %zu is not a power of two of at least one page\n", size);
+    return NULL;
+  }
+
+  fd = (int) syscall(SYS_memfd_create, "volk_ring", 0);
+  if(fd < 0 || ftruncate(fd, size) != 0) {
+    fprintf(stderr, "VOLK: Error allocating ring buffer (memfd: %s)\n", strerror(errno));
+    if(fd >= 0) close(fd);
+    return NULL;
+  }
+
+  // reserve the address range, then map the file twice over its end
+  base = (char *) mmap(NULL, page + 2 * size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  ring = (base == MAP_FAILED)? NULL : base + page;
+  if(ring == NULL ||
+     mmap(ring, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+     mmap(ring + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+    fprintf(stderr, "VOLK: Error allocating ring buffer (mmap: %s)\n", strerror(errno));
+    if(base != MAP_FAILED) munmap(base, page + 2 * size);
+    close(fd);
+    return NULL;
+  }
+  // the mappings keep the memory
+  close(fd);
+
+  header = (struct volk_ring_header *)ring - 1;
+  header->base = base;
+  header->length = page + 2 * size;
+  return ring;
+}
+
+void volk_free_ring(void *ptr)
+{
+  struct volk_ring_header *header;
+  if(ptr == NULL) return;
+  header = (struct volk_ring_header *)ptr - 1;
+  munmap(header->base, header->length);
+}
+
+#else // HAVE_MMAP && HAVE_SYS_MEMFD_CREATE
+
+void *volk_malloc_ring(size_t size)
+{
+  (void)size;
+  fprintf(stderr, "VOLK: ring buffers are not supported on this system\n");
+  return NULL;
+}
+
+void volk_free_ring(void *ptr)
+{
+  (void)ptr;
+}
+
+#endif // HAVE_MMAP && HAVE_SYS_MEMFD_CREATE
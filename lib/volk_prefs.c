@@ -1,7 +1,28 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <volk/volk.h>
+#include <volk/volk_cpu.h>
 #include <volk/volk_prefs.h>
+#include <volk/constants.h>
+#include <volk_rank_archs.h>
+
+#if defined(HAVE_MMAP)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#endif
+
+#if defined(_WIN32)
+#define VOLK_PATH_LIST_SEP ';'
+#else
+#define VOLK_PATH_LIST_SEP ':'
+#endif
 
 void volk_get_config_path(char *path)
 {
@@ -11,15 +32,18 @@ void volk_get_config_path(char *path)
     const char *suffix2 = "/volk/volk_config"; //non-hidden
     char *home = NULL;
 
-    //allows config redirection via env variable
+    //allows config redirection via env variable,
+    //the first entry of a list is where volk_profile writes
     home = getenv("VOLK_CONFIGPATH");
-    if(home!=NULL){
-        strncpy(path,home,512);
-        strcat(path,suffix2);
+    while(home!=NULL && home[0]==VOLK_PATH_LIST_SEP) home++; //empty entries are skipped
+    if(home!=NULL && home[0]){
+        const char *sep = strchr(home, VOLK_PATH_LIST_SEP);
+        const size_t len = sep? (size_t)(sep - home) : strlen(home);
+        snprintf(path, 512, "%.*s%s", (int)len, home, suffix2);
         return;
     }
 
-    if (home == NULL) home = getenv("HOME");
+    home = getenv("HOME");
     if (home == NULL) home = getenv("APPDATA");
     if (home == NULL){
         path[0] = 0;
@@ -30,30 +54,516 @@ void volk_get_config_path(char *path)
     strcat(path, suffix);
 }
 
-size_t volk_load_preferences(volk_arch_pref_t **prefs_res)
+//length of a cpu model string without its trailing "-stepping"
+static size_t volk_cpu_model_family_len(const char *cpu_model)
+{
+    const char *dash = strrchr(cpu_model, '-');
+    return dash? (size_t)(dash - cpu_model) : strlen(cpu_model);
+}
+
+//check a directory for the cpu model specific configs, then volk_config
+static int volk_find_config_in(char *path, const char *dir, size_t dir_len,
+    const char *cpu_model, size_t family_len)
 {
     FILE *config_file;
-    char path[512], line[512];
-    size_t n_arch_prefs = 0;
-    volk_arch_pref_t *prefs = NULL;
+    int i;
+    for(i = 0; i < 3; i++)
+    {
+        if(i == 0) snprintf(path, 512, "%.*s/volk_config_%s", (int)dir_len, dir, cpu_model);
+        if(i == 1) snprintf(path, 512, "%.*s/volk_config_%.*s", (int)dir_len, dir, (int)family_len, cpu_model);
+        if(i == 2) snprintf(path, 512, "%.*s/volk_config", (int)dir_len, dir);
+        config_file = fopen(path, "rb");
+        if(config_file)
+        {
+            fclose(config_file);
+            return 1;
+        }
+    }
+    path[0] = 0;
+    return 0;
+}
 
-    //get the config path
-    volk_get_config_path(path);
-    if (!path[0]) return n_arch_prefs; //no prefs found
-    config_file = fopen(path, "r");
-    if(!config_file) return n_arch_prefs; //no prefs found
+void volk_find_config_path(char *path)
+{
+    char dir[512], cpu_model[64];
+    const char *dirs, *home, *xdg;
+    size_t family_len;
+
+    if (!path) return;
+
+    volk_get_cpu_model(cpu_model, sizeof(cpu_model));
+    family_len = volk_cpu_model_family_len(cpu_model);
+
+    //every directory listed in VOLK_CONFIGPATH
+    dirs = getenv("VOLK_CONFIGPATH");
+    while(dirs != NULL && dirs[0])
+    {
+        const char *sep = strchr(dirs, VOLK_PATH_LIST_SEP);
+        const size_t len = sep? (size_t)(sep - dirs) : strlen(dirs);
+        snprintf(dir, sizeof(dir), "%.*s/volk", (int)len, dirs);
+        if(len && volk_find_config_in(path, dir, strlen(dir), cpu_model, family_len)) return;
+        dirs = sep? sep + 1 : NULL;
+    }
+
+    //the user's own configs
+    home = getenv("HOME");
+    if (home == NULL) home = getenv("APPDATA");
+    if (home != NULL)
+    {
+        snprintf(dir, sizeof(dir), "%s/.volk", home);
+        if(volk_find_config_in(path, dir, strlen(dir), cpu_model, family_len)) return;
+    }
+    xdg = getenv("XDG_CONFIG_HOME");
+    if (xdg != NULL && xdg[0]) snprintf(dir, sizeof(dir), "%s/volk", xdg);
+    else if (home != NULL) snprintf(dir, sizeof(dir), "%s/.config/volk", home);
+    else dir[0] = 0;
+    if(dir[0] && volk_find_config_in(path, dir, strlen(dir), cpu_model, family_len)) return;
+
+    //system wide configs
+#if !defined(_WIN32)
+    if(volk_find_config_in(path, "/etc/volk", strlen("/etc/volk"), cpu_model, family_len)) return;
+#endif
+    snprintf(dir, sizeof(dir), "%s/share/volk", volk_prefix());
+    if(volk_find_config_in(path, dir, strlen(dir), cpu_model, family_len)) return;
+
+    path[0] = 0;
+}
+
+//the cpu models are the same, or the same but for the stepping
+static int volk_cpu_model_score(const char *profile_model, const char *cpu_model)
+{
+    const size_t family_len = volk_cpu_model_family_len(cpu_model);
+    if(!strcmp(profile_model, cpu_model)) return 2;
+    if(volk_cpu_model_family_len(profile_model) == family_len &&
+        !strncmp(profile_model, cpu_model, family_len)) return 1;
+    return 0;
+}
+
+size_t volk_load_default_preferences(const volk_default_profile_t *profiles,
+    const char *cpu_model, volk_arch_pref_t **prefs_res)
+{
+    const volk_default_profile_t *profile, *match = NULL;
+    const volk_default_pref_t *p;
+    volk_arch_pref_t *prefs;
+    size_t n_prefs = 0, i;
+    int best_score = 0;
+
+    for(profile = profiles; profile->cpu_model != NULL; profile++)
+    {
+        const int score = volk_cpu_model_score(profile->cpu_model, cpu_model);
+        if(score > best_score)
+        {
+            match = profile;
+            best_score = score;
+        }
+    }
+    if(match == NULL) return 0;
+
+    for(p = match->prefs; p->name != NULL; p++) n_prefs++;
+    if(n_prefs == 0) return 0;
+    prefs = (volk_arch_pref_t *) calloc(n_prefs, sizeof(*prefs));
+    if(prefs == NULL) return 0;
+    for(i = 0, p = match->prefs; i < n_prefs; i++, p++)
+    {
+        volk_arch_pref_t *pref = prefs + i;
+        strncpy(pref->name, p->name, sizeof(pref->name)-1);
+        strncpy(pref->impl_a, p->impl_a, sizeof(pref->impl_a)-1);
+        strncpy(pref->impl_u, p->impl_u, sizeof(pref->impl_u)-1);
+        strncpy(pref->bucket_impl_a[VOLK_VLEN_BUCKET_SMALL], p->bucket_impls[0], sizeof(pref->impl_a)-1);
+        strncpy(pref->bucket_impl_u[VOLK_VLEN_BUCKET_SMALL], p->bucket_impls[1], sizeof(pref->impl_u)-1);
+        strncpy(pref->bucket_impl_a[VOLK_VLEN_BUCKET_MEDIUM], p->bucket_impls[2], sizeof(pref->impl_a)-1);
+        strncpy(pref->bucket_impl_u[VOLK_VLEN_BUCKET_MEDIUM], p->bucket_impls[3], sizeof(pref->impl_u)-1);
+        strncpy(pref->bucket_impl_a[VOLK_VLEN_BUCKET_LARGE], p->impl_a, sizeof(pref->impl_a)-1);
+        strncpy(pref->bucket_impl_u[VOLK_VLEN_BUCKET_LARGE], p->impl_u, sizeof(pref->impl_u)-1);
+    }
+    *prefs_res = prefs;
+    return n_prefs;
+}
+
+int volk_pref_usable(const volk_arch_pref_t *pref,
+    const char *impl_names[], size_t n_impls)
+{
+    size_t bucket;
+    for(bucket = 0; bucket < VOLK_N_VLEN_BUCKETS; bucket++)
+    {
+        if(volk_find_index(impl_names, n_impls, pref->bucket_impl_a[bucket]) < 0) return 0;
+        if(volk_find_index(impl_names, n_impls, pref->bucket_impl_u[bucket]) < 0) return 0;
+    }
+    return 1;
+}
+
+//fill the bucket entries of a pref that only names impl_a and impl_u
+static void volk_fill_buckets(volk_arch_pref_t *p, const int has_buckets)
+{
+    //without bucket entries the impl is used for all vector lengths
+    if(!has_buckets)
+    {
+        strcpy(p->bucket_impl_a[VOLK_VLEN_BUCKET_SMALL], p->impl_a);
+        strcpy(p->bucket_impl_u[VOLK_VLEN_BUCKET_SMALL], p->impl_u);
+        strcpy(p->bucket_impl_a[VOLK_VLEN_BUCKET_MEDIUM], p->impl_a);
+        strcpy(p->bucket_impl_u[VOLK_VLEN_BUCKET_MEDIUM], p->impl_u);
+    }
+    strcpy(p->bucket_impl_a[VOLK_VLEN_BUCKET_LARGE], p->impl_a);
+    strcpy(p->bucket_impl_u[VOLK_VLEN_BUCKET_LARGE], p->impl_u);
+}
+
+static size_t volk_load_text_preferences(FILE *config_file, volk_arch_pref_t **prefs_res)
+{
+    char line[512];
+    size_t n_arch_prefs = 0, n_alloc = 0;
+    volk_arch_pref_t *prefs = NULL;
 
-    //reset the file pointer and write the prefs into volk_arch_prefs
     while(fgets(line, sizeof(line), config_file) != NULL)
     {
-        prefs = (volk_arch_pref_t *) realloc(prefs, (n_arch_prefs+1) * sizeof(*prefs));
+        //grow by doubling rather than once per line
+        if(n_arch_prefs == n_alloc)
+        {
+            n_alloc = n_alloc? 2*n_alloc : 64;
+            prefs = (volk_arch_pref_t *) realloc(prefs, n_alloc * sizeof(*prefs));
+        }
         volk_arch_pref_t *p = prefs + n_arch_prefs;
-        if(sscanf(line, "%s %s %s", p->name, p->impl_a, p->impl_u) == 3 && !strncmp(p->name, "volk_", 5))
+        const int n_fields = sscanf(line, "%127s %127s %127s %127s %127s %127s %127s",
+            p->name, p->impl_a, p->impl_u,
+            p->bucket_impl_a[VOLK_VLEN_BUCKET_SMALL], p->bucket_impl_u[VOLK_VLEN_BUCKET_SMALL],
+            p->bucket_impl_a[VOLK_VLEN_BUCKET_MEDIUM], p->bucket_impl_u[VOLK_VLEN_BUCKET_MEDIUM]);
+        if((n_fields == 3 || n_fields == 7) && !strncmp(p->name, "volk_", 5))
         {
+            volk_fill_buckets(p, n_fields == 7);
             n_arch_prefs++;
         }
     }
-    fclose(config_file);
     *prefs_res = prefs;
     return n_arch_prefs;
 }
+
+//read the whole file at path, mapped where mmap is available
+static void *volk_map_config(const char *path, size_t *size)
+{
+#if defined(HAVE_MMAP)
+    struct stat st;
+    void *data;
+    const int fd = open(path, O_RDONLY);
+    if(fd < 0) return NULL;
+    if(fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    //private and writable so records can be handed out as non-const prefs
+    data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED) return NULL;
+    *size = st.st_size;
+    return data;
+#else
+    FILE *config_file;
+    long length;
+    void *data;
+    config_file = fopen(path, "rb");
+    if(!config_file) return NULL;
+    if(fseek(config_file, 0, SEEK_END) != 0 || (length = ftell(config_file)) <= 0)
+    {
+        fclose(config_file);
+        return NULL;
+    }
+    rewind(config_file);
+    data = malloc(length);
+    if(data && fread(data, 1, length, config_file) != (size_t)length)
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(config_file);
+    *size = length;
+    return data;
+#endif
+}
+
+static void volk_unmap_config(void *data, size_t size)
+{
+#if defined(HAVE_MMAP)
+    munmap(data, size);
+#else
+    (void)size;
+    free(data);
+#endif
+}
+
+//binary configs whose records were handed out in place,
+//so that volk_free_preferences can tell them from text configs
+typedef struct volk_config_mapping
+{
+    void *data;
+    size_t size;
+    struct volk_config_mapping *next;
+} volk_config_mapping_t;
+
+static volk_config_mapping_t *volk_config_mappings = NULL;
+static volatile int volk_config_mappings_busy = 0;
+
+static void volk_config_mappings_lock(void)
+{
+#if defined(_MSC_VER)
+    while(InterlockedExchange((volatile LONG *)&volk_config_mappings_busy, 1) != 0);
+#else
+    while(__sync_lock_test_and_set(&volk_config_mappings_busy, 1) != 0);
+#endif
+}
+
+static void volk_config_mappings_unlock(void)
+{
+#if defined(_MSC_VER)
+    InterlockedExchange((volatile LONG *)&volk_config_mappings_busy, 0);
+#else
+    __sync_lock_release(&volk_config_mappings_busy);
+#endif
+}
+
+//returns 0 when the mapping could not be recorded
+static int volk_add_config_mapping(void *data, size_t size)
+{
+    volk_config_mapping_t *mapping = (volk_config_mapping_t *) malloc(sizeof(*mapping));
+    if(!mapping) return 0;
+    mapping->data = data;
+    mapping->size = size;
+    volk_config_mappings_lock();
+    mapping->next = volk_config_mappings;
+    volk_config_mappings = mapping;
+    volk_config_mappings_unlock();
+    return 1;
+}
+
+void volk_free_preferences(volk_arch_pref_t *prefs)
+{
+    volk_config_mapping_t **link, *mapping = NULL;
+    if(!prefs) return;
+
+    volk_config_mappings_lock();
+    for(link = &volk_config_mappings; *link != NULL; link = &(*link)->next)
+    {
+        const char *data = (const char *)(*link)->data;
+        if((const char *)prefs >= data && (const char *)prefs < data + (*link)->size)
+        {
+            mapping = *link;
+            *link = mapping->next;
+            break;
+        }
+    }
+    volk_config_mappings_unlock();
+
+    if(!mapping)
+    {
+        free(prefs);
+        return;
+    }
+    volk_unmap_config(mapping->data, mapping->size);
+    free(mapping);
+}
+
+//true when the fixed size string field holds its terminating \0
+#define VOLK_FIELD_TERMINATED(field) (memchr((field), 0, sizeof(field)) != NULL)
+
+//every string of a record is used as a C string
+static int volk_binary_pref_valid(const volk_arch_pref_t *pref)
+{
+    size_t bucket;
+    if(!VOLK_FIELD_TERMINATED(pref->name)) return 0;
+    if(!VOLK_FIELD_TERMINATED(pref->impl_a)) return 0;
+    if(!VOLK_FIELD_TERMINATED(pref->impl_u)) return 0;
+    for(bucket = 0; bucket < VOLK_N_VLEN_BUCKETS; bucket++)
+    {
+        if(!VOLK_FIELD_TERMINATED(pref->bucket_impl_a[bucket])) return 0;
+        if(!VOLK_FIELD_TERMINATED(pref->bucket_impl_u[bucket])) return 0;
+    }
+    return 1;
+}
+
+//check the header, that every section lies within the file
+//and that all strings of the sections and records are terminated
+static int volk_binary_config_valid(const void *data, size_t size)
+{
+    const volk_config_header_t *header = (const volk_config_header_t *)data;
+    const volk_config_section_t *sections = (const volk_config_section_t *)(header + 1);
+    const volk_arch_pref_t *prefs;
+    uint64_t j;
+    uint32_t i;
+
+    if(size < sizeof(*header)) return 0;
+    if(memcmp(header->magic, VOLK_CONFIG_MAGIC, sizeof(header->magic)) != 0) return 0;
+    if(header->version != VOLK_CONFIG_VERSION) return 0;
+    if(header->pref_size != sizeof(volk_arch_pref_t)) return 0;
+    if(header->n_sections > (size - sizeof(*header)) / sizeof(*sections)) return 0;
+    for(i = 0; i < header->n_sections; i++)
+    {
+        if(sections[i].offset > size) return 0;
+        if(sections[i].n_prefs > (size - sections[i].offset) / sizeof(volk_arch_pref_t)) return 0;
+        if(!VOLK_FIELD_TERMINATED(sections[i].machine)) return 0;
+        if(!VOLK_FIELD_TERMINATED(sections[i].cpu_model)) return 0;
+        prefs = (const volk_arch_pref_t *)((const char *)data + sections[i].offset);
+        for(j = 0; j < sections[i].n_prefs; j++)
+        {
+            if(!volk_binary_pref_valid(prefs + j)) return 0;
+        }
+    }
+    return 1;
+}
+
+//pick the section for machine, preferring the exact cpu model,
+//then the same model in another stepping, then a section for any cpu
+static const volk_config_section_t *volk_find_section(const void *data,
+    const char *machine, const char *cpu_model)
+{
+    const volk_config_header_t *header = (const volk_config_header_t *)data;
+    const volk_config_section_t *sections = (const volk_config_section_t *)(header + 1);
+    const volk_config_section_t *best = NULL;
+    const size_t family_len = volk_cpu_model_family_len(cpu_model);
+    int best_score = 0;
+    uint32_t i;
+
+    for(i = 0; i < header->n_sections; i++)
+    {
+        const volk_config_section_t *section = sections + i;
+        int score = 0;
+        if(strncmp(section->machine, machine, sizeof(section->machine)) != 0) continue;
+        if(!strncmp(section->cpu_model, cpu_model, sizeof(section->cpu_model))) score = 3;
+        else if(volk_cpu_model_family_len(section->cpu_model) == family_len &&
+            !strncmp(section->cpu_model, cpu_model, family_len)) score = 2;
+        else if(section->cpu_model[0] == '\0') score = 1;
+        if(score > best_score)
+        {
+            best = section;
+            best_score = score;
+        }
+    }
+    return best;
+}
+
+size_t volk_load_preferences_file(const char *path, volk_arch_pref_t **prefs_res)
+{
+    FILE *config_file;
+    size_t size = 0, n_arch_prefs = 0;
+    void *data;
+
+    data = volk_map_config(path, &size);
+    if(!data) return n_arch_prefs; //no prefs found
+
+    if(volk_binary_config_valid(data, size))
+    {
+        char cpu_model[64];
+        const volk_config_section_t *section;
+        volk_get_cpu_model(cpu_model, sizeof(cpu_model));
+        section = volk_find_section(data, volk_get_machine(), cpu_model);
+        if(section && section->n_prefs && volk_add_config_mapping(data, size))
+        {
+            //the records are used in place, keep the mapping
+            *prefs_res = (volk_arch_pref_t *)((char *)data + section->offset);
+            return section->n_prefs;
+        }
+        volk_unmap_config(data, size);
+        return n_arch_prefs;
+    }
+
+    //not a binary config, parse it as text
+    volk_unmap_config(data, size);
+    config_file = fopen(path, "r");
+    if(!config_file) return n_arch_prefs; //no prefs found
+    n_arch_prefs = volk_load_text_preferences(config_file, prefs_res);
+    fclose(config_file);
+    return n_arch_prefs;
+}
+
+size_t volk_load_preferences(volk_arch_pref_t **prefs_res)
+{
+    char path[512];
+
+    //get the config path
+    volk_find_config_path(path);
+    if (!path[0]) return 0; //no prefs found
+    return volk_load_preferences_file(path, prefs_res);
+}
+
+int volk_write_binary_preferences(const char *path,
+    const char *machine, const char *cpu_model,
+    const volk_arch_pref_t *prefs, size_t n_prefs)
+{
+    volk_config_header_t header;
+    volk_config_section_t *sections;
+    const volk_arch_pref_t **records;
+    const volk_config_section_t *old_sections = NULL;
+    char tmp_path[520];
+    size_t old_size = 0;
+    void *old_data;
+    uint32_t i, n_sections = 0, n_old = 0;
+    uint64_t offset;
+    FILE *config_file;
+    int ret = 0;
+
+    //keep the sections of other machines and cpu models
+    old_data = volk_map_config(path, &old_size);
+    if(old_data && volk_binary_config_valid(old_data, old_size))
+    {
+        old_sections = (const volk_config_section_t *)((const volk_config_header_t *)old_data + 1);
+        n_old = ((const volk_config_header_t *)old_data)->n_sections;
+    }
+    sections = (volk_config_section_t *) calloc(n_old + 1, sizeof(*sections));
+    records = (const volk_arch_pref_t **) calloc(n_old + 1, sizeof(*records));
+    if(!sections || !records)
+    {
+        if(old_data) volk_unmap_config(old_data, old_size);
+        free(records);
+        free(sections);
+        return -1;
+    }
+    for(i = 0; i < n_old; i++)
+    {
+        if(!strncmp(old_sections[i].machine, machine, sizeof(old_sections[i].machine)) &&
+            !strncmp(old_sections[i].cpu_model, cpu_model, sizeof(old_sections[i].cpu_model))) continue;
+        records[n_sections] = (const volk_arch_pref_t *)((const char *)old_data + old_sections[i].offset);
+        sections[n_sections++] = old_sections[i];
+    }
+    strncpy(sections[n_sections].machine, machine, sizeof(sections[n_sections].machine)-1);
+    strncpy(sections[n_sections].cpu_model, cpu_model, sizeof(sections[n_sections].cpu_model)-1);
+    sections[n_sections].n_prefs = n_prefs;
+    records[n_sections++] = prefs;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, VOLK_CONFIG_MAGIC, sizeof(header.magic));
+    header.version = VOLK_CONFIG_VERSION;
+    header.pref_size = sizeof(volk_arch_pref_t);
+    header.n_sections = n_sections;
+
+    offset = sizeof(header) + n_sections * sizeof(*sections);
+    for(i = 0; i < n_sections; i++)
+    {
+        sections[i].offset = offset;
+        offset += sections[i].n_prefs * sizeof(volk_arch_pref_t);
+    }
+
+    //write a new file next to the old one and swap it in
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    config_file = fopen(tmp_path, "wb");
+    if(!config_file) ret = -1;
+    else
+    {
+        if(fwrite(&header, sizeof(header), 1, config_file) != 1) ret = -1;
+        if(fwrite(sections, sizeof(*sections), n_sections, config_file) != n_sections) ret = -1;
+        for(i = 0; i < n_sections; i++)
+        {
+            if(fwrite(records[i], sizeof(volk_arch_pref_t), sections[i].n_prefs, config_file) != sections[i].n_prefs) ret = -1;
+        }
+        if(fclose(config_file) != 0) ret = -1;
+    }
+    if(old_data) volk_unmap_config(old_data, old_size);
+    free(records);
+    free(sections);
+
+    if(ret == 0)
+    {
+#if defined(_WIN32)
+        remove(path); //rename does not replace on windows
+#endif
+        if(rename(tmp_path, path) != 0) ret = -1;
+    }
+    if(ret != 0) remove(tmp_path);
+    return ret;
+}
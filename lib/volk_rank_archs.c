@@ -25,7 +25,7 @@
 #include <stdlib.h>
 #include <string.h>
 
-int volk_get_index(
+int volk_find_index(
     const char *impl_names[], //list of implementations by name
     const size_t n_impls,     //number of implementations available
     const char *impl_name     //the implementation name to find
@@ -36,29 +36,33 @@ int volk_get_index(
             return i;
         }
     }
+    return -1;
+}
+
+int volk_get_index(
+    const char *impl_names[], //list of implementations by name
+    const size_t n_impls,     //number of implementations available
+    const char *impl_name     //the implementation name to find
+){
+    const int index = volk_find_index(impl_names, n_impls, impl_name);
+    if(index >= 0) return index;
     //TODO return -1;
     //something terrible should happen here
     fprintf(stderr, "Volk warning: no arch found, returning generic impl\n");
-    return volk_get_index(impl_names, n_impls, "generic"); //but we'll fake it for now
+    return volk_find_index(impl_names, n_impls, "generic"); //but we'll fake it for now
 }
 
 int volk_rank_archs(
-    const char *kern_name,    //name of the kernel to rank
+    const volk_arch_pref_t *pref, //preferences for this kernel or NULL
     const char *impl_names[], //list of implementations by name
     const int* impl_deps,     //requirement mask per implementation
     const bool* alignment,    //alignment status of each implementation
     size_t n_impls,            //number of implementations available
-    const bool align          //if false, filter aligned implementations
+    const bool align,         //if false, filter aligned implementations
+    const size_t bucket       //vector length bucket to rank for
 )
 {
     size_t i;
-    static volk_arch_pref_t *volk_arch_prefs;
-    static size_t n_arch_prefs = 0;
-    static int prefs_loaded = 0;
-    if(!prefs_loaded) {
-        n_arch_prefs = volk_load_preferences(&volk_arch_prefs);
-        prefs_loaded = 1;
-    }
 
     // If we've defined VOLK_GENERIC to be anything, always return the
     // 'generic' kernel. Used in GR's QA code.
@@ -67,14 +71,11 @@ int volk_rank_archs(
       return volk_get_index(impl_names, n_impls, "generic");
     }
 
-    //now look for the function name in the prefs list
-    for(i = 0; i < n_arch_prefs; i++)
+    //use the preferred impl when the config lists this kernel
+    if(pref != NULL)
     {
-        if(!strncmp(kern_name, volk_arch_prefs[i].name, sizeof(volk_arch_prefs[i].name))) //found it
-        {
-            const char *impl_name = align? volk_arch_prefs[i].impl_a : volk_arch_prefs[i].impl_u;
-            return volk_get_index(impl_names, n_impls, impl_name);
-        }
+        const char *impl_name = align? pref->bucket_impl_a[bucket] : pref->bucket_impl_u[bucket];
+        return volk_get_index(impl_names, n_impls, impl_name);
     }
 
     //return the best index with the largest deps
@@ -22,6 +22,7 @@
 #ifndef INCLUDED_VOLK_RANK_ARCHS_H
 #define INCLUDED_VOLK_RANK_ARCHS_H
 
+#include <volk/volk_prefs.h>
 #include <stdlib.h>
 #include <stdbool.h>
 
@@ -35,13 +36,21 @@ int volk_get_index(
     const char *impl_name     //the implementation name to find
 );
 
+//like volk_get_index, but returns -1 without a warning when not found
+int volk_find_index(
+    const char *impl_names[], //list of implementations by name
+    const size_t n_impls,     //number of implementations available
+    const char *impl_name     //the implementation name to find
+);
+
 int volk_rank_archs(
-    const char *kern_name,    //name of the kernel to rank
+    const volk_arch_pref_t *pref, //preferences for this kernel or NULL
     const char *impl_names[], //list of implementations by name
     const int* impl_deps,     //requirement mask per implementation
     const bool* alignment,    //alignment status of each implementation
     size_t n_impls,            //number of implementations available
-    const bool align          //if false, filter aligned implementations
+    const bool align,         //if false, filter aligned implementations
+    const size_t bucket       //vector length bucket to rank for
 );
 
 #ifdef __cplusplus
@@ -24,11 +24,20 @@
 #include <volk/volk_typedefs.h>
 #include <volk/volk_cpu.h>
 #include "volk_rank_archs.h"
+#include "volk_autotune.h"
 #include <volk/volk.h>
+#include <volk/volk_prefs.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
 static size_t __alignment = 0;
 static intptr_t __alignment_mask = 0;
 
@@ -110,15 +119,120 @@ bool volk_is_aligned(const void *ptr)
     return ((intptr_t)(ptr) & __alignment_mask) == 0;
 }
 
+//points of size bytes to skip until ptr is aligned, -1 when it never is
+static inline size_t volk_peel_points(const void *ptr, size_t size)
+{
+    const size_t offset = (size_t)((intptr_t)(ptr) & __alignment_mask);
+    const size_t bytes = offset? __alignment - offset : 0;
+    return (bytes % size)? (size_t)-1 : bytes / size;
+}
+
 #define LV_HAVE_GENERIC
 #define LV_HAVE_DISPATCHER
 
+########################################################################
+#def make_aligned_test($kern)
+#set $ptr_names = [a[1] for a in $kern.args if '*' in a[0]]
+volk_is_aligned($(''.join(['VOLK_OR_PTR(%s, ' % n for n in $ptr_names]))0$(')' * len($ptr_names)))#slurp
+#end def
+
+//kernel names in name order; a kernel's position here is its index
+static const char *__volk_kernel_names[] = {
+    #for $kern in $kernels
+    "$kern.name",
+    #end for
+};
+
+//the volk_config entry of each kernel (or NULL), indexed by kernel
+static const volk_arch_pref_t *__volk_kernel_prefs[$(len($kernels))];
+
+static int __volk_kernel_name_cmp(const void *name, const void *entry)
+{
+    return strcmp((const char *)name, *(const char * const *)entry);
+}
+
+//binary search for a kernel by name, returns -1 when it is unknown
+static int volk_kernel_index(const char *name)
+{
+    const char **entry = (const char **)bsearch(name, __volk_kernel_names,
+        $(len($kernels)), sizeof(*__volk_kernel_names), __volk_kernel_name_cmp);
+    if(entry == NULL) return -1;
+    return (int)(entry - __volk_kernel_names);
+}
+
+//built-in preferences from the reference profiles in gen/profiles,
+//used for the kernels that the volk_config does not list
+#for $profile in $profiles
+static const volk_default_pref_t __volk_default_prefs_$(profile.cname)[] = {
+    #for $pref in $profile.prefs
+    {"$pref.kern.name", "$pref.impl_a", "$pref.impl_u", {"$(pref.bucket_impls[0])", "$(pref.bucket_impls[1])", "$(pref.bucket_impls[2])", "$(pref.bucket_impls[3])"}},
+    #end for
+    {NULL, NULL, NULL, {NULL, NULL, NULL, NULL}}
+};
+
+#end for
+static const volk_default_profile_t __volk_default_profiles[] = {
+    #for $profile in $profiles
+    {"$profile.cpu_model", __volk_default_prefs_$(profile.cname)},
+    #end for
+    {NULL, NULL}
+};
+
+//the built-in preference of each kernel (or NULL), indexed by kernel
+static const volk_arch_pref_t *__volk_kernel_defaults[$(len($kernels))];
+
+//the preferences the kernels were ranked with, released when they are loaded again
+static volk_arch_pref_t *__volk_prefs = NULL;
+static volk_arch_pref_t *__volk_tuned = NULL;
+static volk_arch_pref_t *__volk_defaults = NULL;
+
+//pick the reference profile of this cpu model, with or without the stepping
+static void __volk_load_default_prefs(void)
+{
+    char cpu_model[64];
+    size_t n_prefs, i;
+
+    volk_get_cpu_model(cpu_model, sizeof(cpu_model));
+    n_prefs = volk_load_default_preferences(__volk_default_profiles, cpu_model, &__volk_defaults);
+    for(i = 0; i < n_prefs; i++) {
+        const int index = volk_kernel_index(__volk_defaults[i].name);
+        if(index >= 0) __volk_kernel_defaults[index] = &__volk_defaults[i];
+    }
+}
+
+//a built-in preference only applies when this machine has all of its impls,
+//otherwise the kernel is ranked as if there was no preference
+static const volk_arch_pref_t *__volk_usable_default(const volk_arch_pref_t *pref,
+    const char *impl_names[], const size_t n_impls)
+{
+    if(pref == NULL || !volk_pref_usable(pref, impl_names, n_impls)) return NULL;
+    return pref;
+}
+
 #for $kern in $kernels
 
 #if $kern.has_dispatcher
 #include <volk/$(kern.name).h> //pulls in the dispatcher
 #end if
 
+#if $kern.is_elementwise
+#set $ptr_names = [a[1] for a in $kern.args if '*' in a[0]]
+#set $head_args = ', '.join([(a[1], 'head')[a[1] == 'num_points'] for a in $kern.args])
+#set $body_args = ', '.join([(a[1], '%s + head' % a[1])['*' in a[0]] if a[1] != 'num_points' else 'num_points - head' for a in $kern.args])
+//buffers that are equally far from alignment run the unaligned impl up to
+//the first aligned point and the aligned impl on the rest, false when the
+//buffers never align together
+static inline bool __$(kern.name)_peel($kern.pname impl_a, $kern.pname impl_u, $kern.arglist_full)
+{
+    const size_t head = volk_peel_points($ptr_names[0], sizeof(*$ptr_names[0]));
+    if(num_points < VOLK_VLEN_SMALL_MAX || head >= num_points) return false;
+    if(!volk_is_aligned($(''.join(['VOLK_OR_PTR(%s + head, ' % n for n in $ptr_names[1:]]))0$(')' * len($ptr_names[1:])))) return false;
+    impl_u($head_args);
+    impl_a($body_args);
+    return true;
+}
+
+#end if
 static inline void __$(kern.name)_d($kern.arglist_full)
 {
     #if $kern.has_dispatcher
@@ -126,32 +240,97 @@ static inline void __$(kern.name)_d($kern.arglist_full)
     return;
     #end if
 
-    if (volk_is_aligned(
-    #set $num_open_parens = 0
-    #for $arg_type, $arg_name in $kern.args
-        #if '*' in $arg_type
-        VOLK_OR_PTR($arg_name,
-        #set $num_open_parens += 1
-        #end if
-    #end for
-        0$(')'*$num_open_parens)
-    )){
+    if ($make_aligned_test($kern)){
         $(kern.name)_a($kern.arglist_names);
     }
     else{
+        #if $kern.is_elementwise
+        if(__$(kern.name)_peel($(kern.name)_a, $(kern.name)_u, $kern.arglist_names)) return;
+        #end if
         $(kern.name)_u($kern.arglist_names);
     }
 }
 
+#if $kern.has_num_points
+static $kern.pname __$(kern.name)_bucket_a[VOLK_N_VLEN_BUCKETS];
+static $kern.pname __$(kern.name)_bucket_u[VOLK_N_VLEN_BUCKETS];
+
+//only installed when the preferences pick different impls per vector length
+static inline void __$(kern.name)_bucket_d($kern.arglist_full)
+{
+    const size_t bucket = volk_vlen_bucket(num_points);
+    if ($make_aligned_test($kern)){
+        __$(kern.name)_bucket_a[bucket]($kern.arglist_names);
+    }
+    else{
+        #if $kern.is_elementwise
+        if(__$(kern.name)_peel(__$(kern.name)_bucket_a[bucket], __$(kern.name)_bucket_u[bucket], $kern.arglist_names)) return;
+        #end if
+        __$(kern.name)_bucket_u[bucket]($kern.arglist_names);
+    }
+}
+#end if
+
+#if $kern.has_num_points
+static volk_autotune_t __$(kern.name)_tune;
+
+//the dispatcher that the self tuning mode replaces until it is done
+static $kern.pname __$(kern.name)_tuned_d;
+
+//bind a tuned winner to its path, for the vector lengths it was timed at
+static void __$(kern.name)_bind_winner(bool aligned, size_t winner)
+{
+    const $kern.pname impl = get_machine()->$(kern.name)_impls[winner];
+    if(aligned) {
+        $(kern.name)_a = impl;
+        __$(kern.name)_bucket_a[VOLK_VLEN_BUCKET_MEDIUM] = impl;
+        __$(kern.name)_bucket_a[VOLK_VLEN_BUCKET_LARGE] = impl;
+    }
+    else {
+        $(kern.name)_u = impl;
+        __$(kern.name)_bucket_u[VOLK_VLEN_BUCKET_MEDIUM] = impl;
+        __$(kern.name)_bucket_u[VOLK_VLEN_BUCKET_LARGE] = impl;
+    }
+}
+
+//only installed in the self tuning mode, times calls until a winner is bound
+static void __$(kern.name)_tune_d($kern.arglist_full)
+{
+    const bool aligned = $make_aligned_test($kern);
+    const int index = (num_points >= VOLK_VLEN_SMALL_MAX)? volk_autotune_begin(&__$(kern.name)_tune, aligned) : -1;
+    uint64_t ticks;
+    int winner;
+
+    if(index < 0) {
+        if(aligned) $(kern.name)_a($kern.arglist_names);
+        else $(kern.name)_u($kern.arglist_names);
+        return;
+    }
+
+    ticks = volk_autotune_ticks();
+    get_machine()->$(kern.name)_impls[index]($kern.arglist_names);
+    ticks = volk_autotune_ticks() - ticks;
+
+    //bound before the release, so that set_impl cannot be undone
+    winner = volk_autotune_end(&__$(kern.name)_tune, aligned, ticks, num_points);
+    if(winner >= 0) __$(kern.name)_bind_winner(aligned, winner);
+    if(__$(kern.name)_tune.slot[true].done && __$(kern.name)_tune.slot[false].done) {
+        $(kern.name) = __$(kern.name)_tuned_d;
+    }
+    volk_autotune_release(&__$(kern.name)_tune);
+}
+#end if
+
 static inline void __init_$(kern.name)(void)
 {
-    const char *name = get_machine()->$(kern.name)_name;
     const char **impl_names = get_machine()->$(kern.name)_impl_names;
     const int *impl_deps = get_machine()->$(kern.name)_impl_deps;
     const bool *alignment = get_machine()->$(kern.name)_impl_alignment;
     const size_t n_impls = get_machine()->$(kern.name)_n_impls;
-    const size_t index_a = volk_rank_archs(name, impl_names, impl_deps, alignment, n_impls, true/*aligned*/);
-    const size_t index_u = volk_rank_archs(name, impl_names, impl_deps, alignment, n_impls, false/*unaligned*/);
+    const volk_arch_pref_t *pref = (__volk_kernel_prefs[$kern.index] != NULL)? __volk_kernel_prefs[$kern.index] :
+        __volk_usable_default(__volk_kernel_defaults[$kern.index], impl_names, n_impls);
+    const size_t index_a = volk_rank_archs(pref, impl_names, impl_deps, alignment, n_impls, true/*aligned*/, VOLK_VLEN_BUCKET_LARGE);
+    const size_t index_u = volk_rank_archs(pref, impl_names, impl_deps, alignment, n_impls, false/*unaligned*/, VOLK_VLEN_BUCKET_LARGE);
     $(kern.name)_a = get_machine()->$(kern.name)_impls[index_a];
     $(kern.name)_u = get_machine()->$(kern.name)_impls[index_u];
 
@@ -159,23 +338,53 @@ static inline void __init_$(kern.name)(void)
     assert($(kern.name)_u);
 
     $(kern.name) = &__$(kern.name)_d;
+    #if $kern.has_num_points
+
+    {
+        size_t bucket;
+        bool uniform = true;
+        for(bucket = 0; bucket < VOLK_N_VLEN_BUCKETS; bucket++) {
+            const size_t bucket_a = volk_rank_archs(pref, impl_names, impl_deps, alignment, n_impls, true/*aligned*/, bucket);
+            const size_t bucket_u = volk_rank_archs(pref, impl_names, impl_deps, alignment, n_impls, false/*unaligned*/, bucket);
+            __$(kern.name)_bucket_a[bucket] = get_machine()->$(kern.name)_impls[bucket_a];
+            __$(kern.name)_bucket_u[bucket] = get_machine()->$(kern.name)_impls[bucket_u];
+            if(bucket_a != index_a || bucket_u != index_u) uniform = false;
+        }
+        if(!uniform) $(kern.name) = &__$(kern.name)_bucket_d;
+    }
+
+    //kernels without a volk_config entry tune themselves when asked to
+    if(__volk_kernel_prefs[$kern.index] == NULL && volk_autotune_calls()) {
+        __$(kern.name)_tuned_d = $(kern.name);
+        if(volk_autotune_init(&__$(kern.name)_tune, get_machine()->$(kern.name)_name,
+            impl_names, alignment, n_impls, index_a, index_u)) {
+            $(kern.name) = &__$(kern.name)_tune_d;
+        }
+        if(volk_autotune_tuned(&__$(kern.name)_tune, true)) {
+            __$(kern.name)_bind_winner(true, __$(kern.name)_tune.slot[true].winner);
+        }
+        if(volk_autotune_tuned(&__$(kern.name)_tune, false)) {
+            __$(kern.name)_bind_winner(false, __$(kern.name)_tune.slot[false].winner);
+        }
+    }
+    #end if
 }
 
 static inline void __$(kern.name)_a($kern.arglist_full)
 {
-    __init_$(kern.name)();
+    volk_init();
     $(kern.name)_a($kern.arglist_names);
 }
 
 static inline void __$(kern.name)_u($kern.arglist_full)
 {
-    __init_$(kern.name)();
+    volk_init();
     $(kern.name)_u($kern.arglist_names);
 }
 
 static inline void __$(kern.name)($kern.arglist_full)
 {
-    __init_$(kern.name)();
+    volk_init();
     $(kern.name)($kern.arglist_names);
 }
 
@@ -195,6 +404,81 @@ void $(kern.name)_manual($kern.arglist_full, const char* impl_name)
     );
 }
 
+$kern.pname $(kern.name)_get_impl(const char *impl_name, bool *is_aligned)
+{
+    const int index = volk_find_index(
+        get_machine()->$(kern.name)_impl_names,
+        get_machine()->$(kern.name)_n_impls,
+        impl_name
+    );
+    if(index < 0) return NULL;
+    if(is_aligned != NULL) *is_aligned = get_machine()->$(kern.name)_impl_alignment[index];
+    return get_machine()->$(kern.name)_impls[index];
+}
+
+$kern.pname $(kern.name)_get_dispatch_impl(unsigned int num_points, bool aligned)
+{
+    volk_init();
+    #if $kern.has_num_points
+    if($(kern.name) == &__$(kern.name)_bucket_d) {
+        const size_t bucket = volk_vlen_bucket(num_points);
+        return aligned? __$(kern.name)_bucket_a[bucket] : __$(kern.name)_bucket_u[bucket];
+    }
+    if($(kern.name) == &__$(kern.name)_tune_d) return aligned? $(kern.name)_a : $(kern.name)_u;
+    #end if
+    #if not $kern.has_num_points
+    (void)num_points;
+    #end if
+    #if not $kern.has_dispatcher
+    if($(kern.name) == &__$(kern.name)_d) return aligned? $(kern.name)_a : $(kern.name)_u;
+    #end if
+    return $(kern.name);
+}
+
+$kern.pname $(kern.name)_set_impl(const char *impl_name)
+{
+    $kern.pname impl;
+    bool is_aligned;
+
+    volk_init(); //so that initialization cannot undo the binding
+    if(impl_name == NULL) {
+        __init_$(kern.name)();
+        return $(kern.name);
+    }
+
+    impl = $(kern.name)_get_impl(impl_name, &is_aligned);
+    if(impl == NULL) return NULL;
+    #if $kern.has_num_points
+
+    //a timed call must not rebind the kernel afterwards
+    if(__$(kern.name)_tune.name != NULL) {
+        volk_autotune_stop(&__$(kern.name)_tune);
+        if($(kern.name) == &__$(kern.name)_tune_d) $(kern.name) = __$(kern.name)_tuned_d;
+    }
+    #end if
+
+    //an aligned impl only replaces the aligned path of the dispatcher
+    if(is_aligned) {
+        $(kern.name)_a = impl;
+        #if $kern.has_num_points
+        //keep dispatching by vector length, with impl in every aligned slot
+        if($(kern.name) == &__$(kern.name)_bucket_d) {
+            size_t bucket;
+            for(bucket = 0; bucket < VOLK_N_VLEN_BUCKETS; bucket++) {
+                __$(kern.name)_bucket_a[bucket] = impl;
+            }
+            return impl;
+        }
+        #end if
+        $(kern.name) = &__$(kern.name)_d;
+        return impl;
+    }
+    $(kern.name)_a = impl;
+    $(kern.name)_u = impl;
+    $(kern.name) = impl;
+    return impl;
+}
+
 volk_func_desc_t $(kern.name)_get_func_desc(void) {
     const char **impl_names = get_machine()->$(kern.name)_impl_names;
     const int *impl_deps = get_machine()->$(kern.name)_impl_deps;
@@ -210,3 +494,74 @@ volk_func_desc_t $(kern.name)_get_func_desc(void) {
 }
 
 #end for
+
+static void __volk_init_all(void)
+{
+    volk_arch_pref_t *prefs = NULL, *tuned = NULL;
+    size_t n_prefs, n_tuned, i;
+
+    get_machine(); //sets the alignment used by volk_is_aligned
+
+    //forget the preferences of an earlier initialization
+    memset(__volk_kernel_prefs, 0, sizeof(__volk_kernel_prefs));
+    memset(__volk_kernel_defaults, 0, sizeof(__volk_kernel_defaults));
+    volk_free_preferences(__volk_prefs);
+    volk_free_preferences(__volk_tuned);
+    volk_free_preferences(__volk_defaults);
+    __volk_prefs = __volk_tuned = __volk_defaults = NULL;
+
+    //index the preferences by kernel, the first entry for a kernel wins
+    n_prefs = volk_load_preferences(&prefs);
+    if(n_prefs) __volk_prefs = prefs;
+    for(i = 0; i < n_prefs; i++) {
+        const int index = volk_kernel_index(prefs[i].name);
+        if(index >= 0 && __volk_kernel_prefs[index] == NULL) {
+            __volk_kernel_prefs[index] = &prefs[i];
+        }
+    }
+
+    //then the winners of earlier self tuning runs
+    n_tuned = volk_autotune_load_preferences(&tuned);
+    if(n_tuned) __volk_tuned = tuned;
+    for(i = 0; i < n_tuned; i++) {
+        const int index = volk_kernel_index(tuned[i].name);
+        if(index >= 0 && __volk_kernel_prefs[index] == NULL) {
+            __volk_kernel_prefs[index] = &tuned[i];
+        }
+    }
+
+    //kernels missing from the volk_config use the built-in profile
+    __volk_load_default_prefs();
+
+    #for $kern in $kernels
+    __init_$(kern.name)();
+    #end for
+}
+
+#if defined(_WIN32)
+static INIT_ONCE __volk_init_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK __volk_init_once_cb(PINIT_ONCE once, PVOID param, PVOID *context)
+{
+    __volk_init_all();
+    return TRUE;
+}
+
+void volk_init(void)
+{
+    InitOnceExecuteOnce(&__volk_init_once, __volk_init_once_cb, NULL, NULL);
+}
+#else
+static pthread_once_t __volk_init_once = PTHREAD_ONCE_INIT;
+
+void volk_init(void)
+{
+    pthread_once(&__volk_init_once, &__volk_init_all);
+}
+#endif
+
+void volk_reload_preferences(void)
+{
+    volk_init(); //so that the first initialization cannot run after this one
+    __volk_init_all();
+}
@@ -27,6 +27,7 @@
 #include <volk/volk_common.h>
 #include <volk/volk_complex.h>
 #include <volk/volk_malloc.h>
+#include <volk/volk_arena.h>
 
 #include <stdlib.h>
 #include <stdbool.h>
@@ -41,6 +42,37 @@ typedef struct volk_func_desc
     const size_t n_impls;
 } volk_func_desc_t;
 
+/*!
+ * Resolve the implementation of every kernel.
+ *
+ * Each kernel pointer initially points to a trampoline that performs
+ * this initialization on first use. Calling volk_init() up front moves
+ * that cost (machine detection, loading the volk_config preferences and
+ * ranking every kernel) out of the first kernel call. It is thread-safe
+ * and only does work once; later calls return immediately.
+ */
+VOLK_API void volk_init(void);
+
+/*!
+ * Load the volk_config preferences again and rank every kernel anew.
+ *
+ * Use this after a new volk_config was written, for instance by
+ * volk_profile, or after VOLK_CONFIGPATH changed. Kernels rebound with
+ * <kernel>_set_impl() go back to their preferred implementations. Unlike
+ * volk_init() it must not run while other threads call kernels.
+ */
+VOLK_API void volk_reload_preferences(void);
+
+/*!
+ * Save the kernels tuned so far in the self tuning mode.
+ *
+ * With VOLK_AUTOTUNE set, the winners are saved to volk_autotune next
+ * to the per-user volk_config when the library is unloaded or the
+ * process exits. Call this to save them earlier, or on compilers
+ * without destructor functions (MSVC), where nothing is saved otherwise.
+ */
+VOLK_API void volk_autotune_flush(void);
+
 //! Prints a list of machines available
 VOLK_API void volk_list_machines(void);
 
@@ -64,7 +96,8 @@ VOLK_API size_t volk_get_alignment(void);
  *
  * Note: for performance reasons, this function
  * is not usable until another volk API call is made
- * which will perform certain initialization tasks.
+ * which will perform certain initialization tasks,
+ * such as volk_init().
  *
  * \param ptr the pointer to some memory buffer
  * \return 1 for alignment boundary, else 0
@@ -85,6 +118,37 @@ extern VOLK_API $kern.pname $(kern.name)_u;
 //! Call into a specific implementation given by name
 extern VOLK_API void $(kern.name)_manual($kern.arglist_full, const char* impl_name);
 
+/*!
+ * Get the implementation given by name, to be called directly.
+ * Unlike the manual call, the name is only looked up once.
+ * \param impl_name the name of the implementation
+ * \param is_aligned set when the implementation needs aligned buffers,
+ *        may be NULL
+ * \return the implementation, or NULL for an unknown name
+ */
+extern VOLK_API $kern.pname $(kern.name)_get_impl(const char *impl_name, bool *is_aligned);
+
+/*!
+ * Bind the kernel pointers to the implementation given by name.
+ * An aligned implementation only replaces the aligned pointer and
+ * the aligned path of the dispatcher, the unaligned path keeps its
+ * implementations per vector length; any other one replaces all.
+ * The returned pointer calls the implementation without dispatch.
+ * Pass NULL to go back to the preferred implementations.
+ * \return the bound implementation, or NULL for an unknown name
+ */
+extern VOLK_API $kern.pname $(kern.name)_set_impl(const char *impl_name);
+
+/*!
+ * Get the implementation the kernel pointer currently runs for a call.
+ * Dispatch by vector length and a binding by set_impl are taken into
+ * account; unaligned buffers are assumed not to be peeled.
+ * \param num_points the vector length of the call
+ * \param aligned whether all buffers of the call are aligned
+ * \return the implementation, or the kernel's own dispatcher
+ */
+extern VOLK_API $kern.pname $(kern.name)_get_dispatch_impl(unsigned int num_points, bool aligned);
+
 //! Get description paramaters for this kernel
 extern VOLK_API volk_func_desc_t $(kern.name)_get_func_desc(void);
 #end for
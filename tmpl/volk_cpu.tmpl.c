@@ -21,6 +21,7 @@
 
 #include <volk/volk_cpu.h>
 #include <volk/volk_config_fixed.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -119,6 +120,15 @@ static inline unsigned int get_avx2_enabled(void) {
 #endif
 }
 
+//the OS must save the xmm, ymm, opmask, zmm0-15 upper halves and zmm16-31
+static inline unsigned int get_avx512_enabled(void) {
+#if defined(VOLK_CPU_x86)
+    return (__xgetbv() & 0xe6) == 0xe6;
+#else
+    return 0;
+#endif
+}
+
 //neon detection is linux specific
 #if defined(__arm__) && defined(__linux__)
     #include <asm/hwcap.h>
@@ -200,3 +210,33 @@ unsigned int volk_get_lvarch() {
     #end for
     return retval;
 }
+
+void volk_get_cpu_model(char *model, size_t len) {
+    if (!model || !len) return;
+#if defined(VOLK_CPU_x86)
+    unsigned int regs[4];
+    char vendor[13];
+    unsigned int family, cpu_model, stepping;
+
+    //the vendor string is spread over ebx, edx, ecx of leaf 0
+    memset(regs, 0, sizeof(unsigned int)*4);
+    cpuid_x86(0, regs);
+    memcpy(vendor+0, &regs[1], 4);
+    memcpy(vendor+4, &regs[3], 4);
+    memcpy(vendor+8, &regs[2], 4);
+    vendor[12] = '\0';
+
+    //display family and model as documented for leaf 1
+    memset(regs, 0, sizeof(unsigned int)*4);
+    cpuid_x86(1, regs);
+    stepping = regs[0] & 0xf;
+    cpu_model = (regs[0] >> 4) & 0xf;
+    family = (regs[0] >> 8) & 0xf;
+    if (family == 0x6 || family == 0xf) cpu_model += ((regs[0] >> 16) & 0xf) << 4;
+    if (family == 0xf) family += (regs[0] >> 20) & 0xff;
+
+    snprintf(model, len, "%s-%u-%u-%u", vendor, family, cpu_model, stepping);
+#else
+    snprintf(model, len, "unknown");
+#endif
+}
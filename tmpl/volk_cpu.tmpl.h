@@ -23,6 +23,7 @@
 #define INCLUDED_VOLK_CPU_H
 
 #include <volk/volk_common.h>
+#include <stdlib.h>
 
 __VOLK_DECL_BEGIN
 
@@ -37,6 +38,9 @@ extern struct VOLK_CPU volk_cpu;
 void volk_cpu_init ();
 unsigned int volk_get_lvarch ();
 
+//writes "vendor-family-model-stepping" of this cpu (or "unknown") into model
+VOLK_API void volk_get_cpu_model(char *model, size_t len);
+
 __VOLK_DECL_END
 
 #endif /*INCLUDED_VOLK_CPU_H*/
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2016 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#set $this_machine = $machine_dict[$args[0]]
+#set $this_archs = [a for a in $this_machine.archs if a.name != 'orc']
+#set $arch_names = [a.name for a in $this_archs]
+#set $prefs = dict([(p.kern.name, p) for p in ($parse_profile($args[1]) if len($args) > 1 else [])])
+
+#ifndef INCLUDED_VOLK_STATIC_H
+#define INCLUDED_VOLK_STATIC_H
+
+#ifdef INCLUDED_VOLK_RUNTIME
+#error "volk/volk_static.h replaces volk/volk.h, include only one of them"
+#endif
+
+/*!
+ * Static dispatch for the $this_machine.name machine.
+ *
+ * Every kernel is an inline function calling one implementation
+ * directly, picked when VOLK was built. There are no function pointers
+ * and no alignment checks, so the compiler can inline the kernels.
+ * Code including this header must be compiled for the machine, ie with
+ * the compiler flags that VOLK uses for it, and must not include
+ * volk/volk.h.
+ */
+
+#for $arch in $this_archs
+#define LV_HAVE_$(arch.name.upper()) 1
+#end for
+
+#include <volk/volk_common.h>
+#include <volk/volk_complex.h>
+#include <volk/volk_config_fixed.h>
+#include <volk/volk_malloc.h>
+#include <volk/volk_arena.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+//! The machine this header was generated for
+#define VOLK_STATIC_MACHINE "$this_machine.name"
+
+//! Get the machine alignment in bytes
+static inline size_t volk_get_alignment(void)
+{
+    return $this_machine.alignment;
+}
+
+//some kernels include volk/volk.h for the allocation helpers above
+#define INCLUDED_VOLK_RUNTIME
+
+#for $kern in $kernels
+#include <volk/$(kern.name).h>
+#end for
+
+__VOLK_DECL_BEGIN
+
+#for $kern in $kernels
+#set $impls = $static_impls($kern, $arch_names, $prefs.get($kern.name))
+
+//! Calls the $impls[1] implementation of $kern.name
+static inline void $(kern.name)($kern.arglist_full)
+{
+    $(kern.name)_$(impls[1])($kern.arglist_names);
+}
+
+//! Calls the $impls[0] implementation of $kern.name, needs aligned buffers
+static inline void $(kern.name)_a($kern.arglist_full)
+{
+    $(kern.name)_$(impls[0])($kern.arglist_names);
+}
+
+//! Calls the $impls[1] implementation of $kern.name
+static inline void $(kern.name)_u($kern.arglist_full)
+{
+    $(kern.name)_$(impls[1])($kern.arglist_names);
+}
+#end for
+
+__VOLK_DECL_END
+
+#endif /*INCLUDED_VOLK_STATIC_H*/